@@ -37,6 +37,8 @@
 #define LSOF_PATH                   @"/usr/sbin/lsof"
 #define LSOF_ARGS                   @[@"-F", @"fpPcntuaTdDiR", @"+c0"]
 #define LSOF_NO_DNS_ARGS            @[@"-n", @"-P"]
+#define LSOF_READ_CHUNK_SIZE        (256 * 1024)
+#define LSOF_PARSE_SEGMENT_SIZE     (4 * 1024 * 1024)
 
 #define DYNAMIC_UTI_PREFIX          @"dyn."
 
@@ -0,0 +1,59 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class Snapshot;
+
+// Connections between pipes and sockets in a snapshot. Files are grouped by
+// device character code, and each file with a peer code has an edge to the
+// group of files with that code. Groups are stored contiguously in a single
+// array of file indices, so building the graph takes linear time and
+// looking up endpoints doesn't allocate.
+@interface EndpointGraph : NSObject
+
+@property (readonly) NSUInteger edgeCount;
+
+- (instancetype)initWithSnapshot:(Snapshot *)snapshot;
+
+// Indices of the files at the other end of a pipe or socket.
+// Returns the number of endpoints and sets indices to point into
+// the graph, which is valid for as long as the graph is.
+- (NSUInteger)endpointsForFile:(NSUInteger)fileIndex indices:(const uint32_t * __nullable * __nonnull)indices;
+
+// Indices of all processes with a pipe or socket connected to one of the
+// given process's files, in either direction. Excludes the process itself.
+- (NSIndexSet *)processesConnectedToProcess:(NSUInteger)processIndex;
+
+@end
+
+NS_ASSUME_NONNULL_END
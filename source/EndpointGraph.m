@@ -0,0 +1,223 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "EndpointGraph.h"
+
+#import "Common.h"
+#import "Snapshot.h"
+
+#define NO_GROUP UINT32_MAX
+
+@interface EndpointGraph ()
+{
+    __weak Snapshot *snapshot;
+    
+    // File indices of each group, group g at members[groupStart[g]]
+    // through members[groupStart[g + 1] - 1]
+    uint32_t *members;
+    uint32_t *groupStart;
+    NSUInteger groupCount;
+    
+    // Group of each file's own code, and of its peer code
+    uint32_t *fileGroup;
+    uint32_t *peerGroup;
+}
+@end
+
+@implementation EndpointGraph
+
+- (instancetype)initWithSnapshot:(Snapshot *)s {
+    self = [super init];
+    if (self) {
+        snapshot = s;
+        [self build:s];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(members);
+    free(groupStart);
+    free(fileGroup);
+    free(peerGroup);
+}
+
+- (void)build:(Snapshot *)s {
+    const FileRecord *files = s.files;
+    NSUInteger fileCount = s.fileCount;
+    
+    fileGroup = malloc(MAX(fileCount, 1) * sizeof(uint32_t));
+    peerGroup = malloc(MAX(fileCount, 1) * sizeof(uint32_t));
+    if (fileGroup == NULL || peerGroup == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for endpoint graph"];
+    }
+    
+    // Open addressing table mapping codes to groups, load factor <= 0.5
+    NSUInteger numCodes = 0;
+    for (NSUInteger i = 0; i < fileCount; i++) {
+        if (files[i].devCharCode) {
+            numCodes++;
+        }
+    }
+    NSUInteger numSlots = 16;
+    while (numSlots < numCodes * 2) {
+        numSlots <<= 1;
+    }
+    NSUInteger mask = numSlots - 1;
+    uint64_t *slotCodes = calloc(numSlots, sizeof(uint64_t));
+    uint32_t *slotGroups = malloc(numSlots * sizeof(uint32_t));
+    
+    // Assign groups and count the members of each
+    uint32_t *counts = calloc(numCodes + 1, sizeof(uint32_t));
+    if (slotCodes == NULL || slotGroups == NULL || counts == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for endpoint graph"];
+    }
+    groupCount = 0;
+    for (NSUInteger i = 0; i < fileCount; i++) {
+        uint64_t code = files[i].devCharCode;
+        if (code == 0) {
+            fileGroup[i] = NO_GROUP;
+            continue;
+        }
+        NSUInteger slot = (NSUInteger)(code * 0x9E3779B97F4A7C15ULL >> 32) & mask;
+        while (slotCodes[slot] && slotCodes[slot] != code) {
+            slot = (slot + 1) & mask;
+        }
+        if (slotCodes[slot] == 0) {
+            slotCodes[slot] = code;
+            slotGroups[slot] = (uint32_t)groupCount++;
+        }
+        fileGroup[i] = slotGroups[slot];
+        counts[fileGroup[i]]++;
+    }
+    
+    // Prefix sums give the start of each group in the member array
+    groupStart = malloc((groupCount + 1) * sizeof(uint32_t));
+    if (groupStart == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for endpoint graph"];
+    }
+    uint32_t offset = 0;
+    for (NSUInteger g = 0; g < groupCount; g++) {
+        groupStart[g] = offset;
+        offset += counts[g];
+        counts[g] = groupStart[g];
+    }
+    groupStart[groupCount] = offset;
+    
+    // Fill in members in file order, reusing counts as insertion cursors
+    members = malloc(MAX(offset, 1) * sizeof(uint32_t));
+    if (members == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for endpoint graph"];
+    }
+    for (NSUInteger i = 0; i < fileCount; i++) {
+        if (fileGroup[i] != NO_GROUP) {
+            members[counts[fileGroup[i]]++] = (uint32_t)i;
+        }
+    }
+    
+    // Resolve peer codes to groups
+    _edgeCount = 0;
+    for (NSUInteger i = 0; i < fileCount; i++) {
+        uint64_t code = files[i].peerCharCode;
+        peerGroup[i] = NO_GROUP;
+        if (code == 0) {
+            continue;
+        }
+        NSUInteger slot = (NSUInteger)(code * 0x9E3779B97F4A7C15ULL >> 32) & mask;
+        while (slotCodes[slot]) {
+            if (slotCodes[slot] == code) {
+                uint32_t g = slotGroups[slot];
+                peerGroup[i] = g;
+                _edgeCount += groupStart[g + 1] - groupStart[g];
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+    
+    free(counts);
+    free(slotCodes);
+    free(slotGroups);
+}
+
+// Needs to run with root privileges for successful lookup of the
+// endpoints of system process pipes/sockets such as syslogd.
+- (NSUInteger)endpointsForFile:(NSUInteger)fileIndex indices:(const uint32_t * __nullable * __nonnull)indices {
+    *indices = NULL;
+    if (fileIndex >= snapshot.fileCount) {
+        return 0;
+    }
+    uint32_t g = peerGroup[fileIndex];
+    if (g == NO_GROUP) {
+        return 0;
+    }
+    *indices = &members[groupStart[g]];
+    return groupStart[g + 1] - groupStart[g];
+}
+
+- (NSIndexSet *)processesConnectedToProcess:(NSUInteger)processIndex {
+    Snapshot *s = snapshot;
+    NSMutableIndexSet *connected = [NSMutableIndexSet indexSet];
+    if (s == nil || processIndex >= s.processCount) {
+        return connected;
+    }
+    const FileRecord *files = s.files;
+    const ProcessRecord *p = &s.processes[processIndex];
+    
+    // Outgoing edges, and the groups the process's own files belong to
+    uint8_t *ownGroups = calloc(MAX(groupCount, 1), 1);
+    if (ownGroups == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for endpoint graph"];
+    }
+    for (NSUInteger i = p->firstFile; i < p->firstFile + p->numFiles; i++) {
+        if (fileGroup[i] != NO_GROUP) {
+            ownGroups[fileGroup[i]] = 1;
+        }
+        const uint32_t *endpoints;
+        NSUInteger count = [self endpointsForFile:i indices:&endpoints];
+        for (NSUInteger e = 0; e < count; e++) {
+            [connected addIndex:files[endpoints[e]].process];
+        }
+    }
+    
+    // Incoming edges from files whose peer is one of the process's files
+    NSUInteger fileCount = s.fileCount;
+    for (NSUInteger i = 0; i < fileCount; i++) {
+        if (peerGroup[i] != NO_GROUP && ownGroups[peerGroup[i]]) {
+            [connected addIndex:files[i].process];
+        }
+    }
+    free(ownGroups);
+    
+    [connected removeIndex:processIndex];
+    return connected;
+}
+
+@end
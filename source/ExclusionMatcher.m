@@ -0,0 +1,357 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "ExclusionMatcher.h"
+
+#import "Common.h"
+#import "NSString+RegexConvenience.h"
+
+#define NO_STATE        UINT32_MAX
+#define ALPHABET_SIZE   128 // Literal patterns are ASCII only
+
+typedef struct {
+    uint32_t length;
+    BOOL anchoredStart;
+    BOOL anchoredEnd;
+    int32_t next;       // Next literal ending in the same state, or -1
+} Literal;
+
+static inline BOOL IsEscaped(NSString *pattern, NSUInteger index) {
+    NSUInteger numBackslashes = 0;
+    while (index > numBackslashes && [pattern characterAtIndex:index - numBackslashes - 1] == '\\') {
+        numBackslashes++;
+    }
+    return (numBackslashes % 2) == 1;
+}
+
+// Get the string matched by a regex that only matches a fixed string,
+// e.g. "\.metallib$" or ".*/Caches/.*". Returns NO for any other regex.
+static BOOL ParseLiteral(NSString *pattern, NSMutableData *literal, BOOL *anchoredStart, BOOL *anchoredEnd) {
+    NSString *body = pattern;
+    *anchoredStart = NO;
+    *anchoredEnd = NO;
+    
+    // A leading or trailing .* makes no difference to an unanchored search
+    if ([body hasPrefix:@"^"]) {
+        *anchoredStart = YES;
+        body = [body substringFromIndex:1];
+    } else if ([body hasPrefix:@".*"]) {
+        body = [body substringFromIndex:2];
+    }
+    if ([body hasSuffix:@"$"] && !IsEscaped(body, [body length] - 1)) {
+        *anchoredEnd = YES;
+        body = [body substringToIndex:[body length] - 1];
+    } else if ([body hasSuffix:@".*"] && !IsEscaped(body, [body length] - 2)) {
+        body = [body substringToIndex:[body length] - 2];
+    }
+    
+    NSCharacterSet *metaCharacters = [NSCharacterSet characterSetWithCharactersInString:@"^$.|?*+()[]{}"];
+    [literal setLength:0];
+    for (NSUInteger i = 0; i < [body length]; i++) {
+        unichar c = [body characterAtIndex:i];
+        if (c == '\\') {
+            // Escaped punctuation is literal, other escapes are classes or assertions
+            if (++i == [body length]) {
+                return NO;
+            }
+            c = [body characterAtIndex:i];
+            if (c > 0x7e || !ispunct(c)) {
+                return NO;
+            }
+        } else if (c < 0x20 || c > 0x7e || [metaCharacters characterIsMember:c]) {
+            return NO;
+        }
+        uint8_t byte = (uint8_t)c;
+        [literal appendBytes:&byte length:1];
+    }
+    return ([literal length] > 0);
+}
+
+// Flag settings and backreferences would apply to the other
+// alternatives if the pattern were part of a combined regex
+static BOOL NeedsOwnRegex(NSString *pattern) {
+    for (NSUInteger i = 0; i + 1 < [pattern length]; i++) {
+        unichar c = [pattern characterAtIndex:i];
+        unichar next = [pattern characterAtIndex:i + 1];
+        if (c == '\\') {
+            if ((next >= '1' && next <= '9') || next == 'k') {
+                return YES;
+            }
+            i++; // Skip escaped character
+        } else if (c == '(' && next == '?') {
+            if (i + 2 >= [pattern length] || [pattern characterAtIndex:i + 2] != ':') {
+                return YES;
+            }
+        }
+    }
+    return NO;
+}
+
+@interface ExclusionMatcher ()
+{
+    // Aho-Corasick automaton over literal patterns, as a full DFA
+    uint32_t *transitions;
+    int32_t *stateLiteral;  // First literal ending in state, or -1
+    uint32_t *outputLink;   // Nearest suffix state where a literal ends
+    NSUInteger numStates;
+    Literal *literals;
+    NSUInteger numLiterals;
+    
+    // Combined regex for all other patterns, plus any that can't be combined
+    NSArray<NSRegularExpression *> *regexes;
+}
+@end
+
+@implementation ExclusionMatcher
+
++ (instancetype)currentMatcher {
+    static ExclusionMatcher *currentMatcher;
+    static NSArray *currentFilters;
+    
+    NSArray *filters = [DEFAULTS objectForKey:@"filters"];
+    @synchronized (self) {
+        if (currentMatcher && (filters == currentFilters || [filters isEqual:currentFilters])) {
+            return currentMatcher;
+        }
+        
+        NSMutableArray<NSString *> *patterns = [NSMutableArray new];
+        for (NSArray *ps in filters) {
+            if ([ps[0] boolValue] == NO) {
+                continue;
+            }
+            NSString *str = [ps[1] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+            if ([str length]) {
+                [patterns addObject:str];
+            }
+        }
+        currentFilters = [filters copy];
+        currentMatcher = [[ExclusionMatcher alloc] initWithPatterns:patterns];
+        return currentMatcher;
+    }
+}
+
+- (instancetype)initWithPatterns:(NSArray<NSString *> *)patterns {
+    self = [super init];
+    if (self) {
+        _patterns = [patterns copy];
+        [self compile];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(transitions);
+    free(stateLiteral);
+    free(outputLink);
+    free(literals);
+}
+
+- (BOOL)isEmpty {
+    return (numLiterals == 0 && [regexes count] == 0);
+}
+
+#pragma mark - Compile
+
+- (void)compile {
+    NSMutableArray<NSData *> *literalBytes = [NSMutableArray new];
+    literals = calloc(MAX([_patterns count], 1), sizeof(Literal));
+    NSMutableArray<NSString *> *combinable = [NSMutableArray new];
+    NSMutableArray<NSRegularExpression *> *separate = [NSMutableArray new];
+    
+    for (NSString *pattern in _patterns) {
+        NSError *err;
+        NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:pattern
+                                                                               options:0
+                                                                                 error:&err];
+        if (!regex) {
+            DLog(@"Error creating settings filter regex: %@", [err localizedDescription]);
+            continue;
+        }
+        
+        NSMutableData *literal = [NSMutableData new];
+        Literal *l = &literals[numLiterals];
+        if (ParseLiteral(pattern, literal, &l->anchoredStart, &l->anchoredEnd)) {
+            l->length = (uint32_t)[literal length];
+            [literalBytes addObject:literal];
+            numLiterals++;
+        } else if (NeedsOwnRegex(pattern)) {
+            [separate addObject:regex];
+        } else {
+            [combinable addObject:pattern];
+        }
+    }
+    
+    // Combine remaining patterns into a single alternation
+    if ([combinable count] > 1) {
+        NSMutableArray<NSString *> *groups = [NSMutableArray new];
+        for (NSString *pattern in combinable) {
+            [groups addObject:[NSString stringWithFormat:@"(?:%@)", pattern]];
+        }
+        NSRegularExpression *combined = [NSRegularExpression regularExpressionWithPattern:[groups componentsJoinedByString:@"|"]
+                                                                                  options:0
+                                                                                    error:nil];
+        if (combined) {
+            [separate insertObject:combined atIndex:0];
+            [combinable removeAllObjects];
+        }
+    }
+    for (NSString *pattern in combinable) {
+        [separate addObject:[NSRegularExpression regularExpressionWithPattern:pattern options:0 error:nil]];
+    }
+    regexes = separate;
+    
+    [self buildAutomaton:literalBytes];
+    
+    DLog(@"Compiled %lu exclusion filters into %lu literals (%lu states) and %lu regexes",
+         (unsigned long)[_patterns count], (unsigned long)numLiterals,
+         (unsigned long)numStates, (unsigned long)[regexes count]);
+}
+
+- (void)buildAutomaton:(NSArray<NSData *> *)literalBytes {
+    if (numLiterals == 0) {
+        return;
+    }
+    
+    NSUInteger maxStates = 1;
+    for (NSData *bytes in literalBytes) {
+        maxStates += [bytes length];
+    }
+    transitions = malloc(maxStates * ALPHABET_SIZE * sizeof(uint32_t));
+    stateLiteral = malloc(maxStates * sizeof(int32_t));
+    outputLink = malloc(maxStates * sizeof(uint32_t));
+    uint32_t *fail = malloc(maxStates * sizeof(uint32_t));
+    uint32_t *queue = malloc(maxStates * sizeof(uint32_t));
+    if (!transitions || !stateLiteral || !outputLink || !fail || !queue) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for exclusion filters"];
+    }
+    memset(transitions, 0xFF, maxStates * ALPHABET_SIZE * sizeof(uint32_t));
+    memset(stateLiteral, 0xFF, maxStates * sizeof(int32_t));
+    
+    // Trie of all literals
+    numStates = 1;
+    for (NSUInteger i = 0; i < numLiterals; i++) {
+        const uint8_t *bytes = [literalBytes[i] bytes];
+        uint32_t s = 0;
+        for (NSUInteger j = 0; j < literals[i].length; j++) {
+            uint32_t *t = &transitions[s * ALPHABET_SIZE + bytes[j]];
+            if (*t == NO_STATE) {
+                *t = (uint32_t)numStates++;
+            }
+            s = *t;
+        }
+        literals[i].next = stateLiteral[s];
+        stateLiteral[s] = (int32_t)i;
+    }
+    
+    // Fill in failure transitions breadth first, so that the
+    // failure state of each state is complete before the state
+    NSUInteger head = 0;
+    NSUInteger tail = 0;
+    fail[0] = 0;
+    outputLink[0] = NO_STATE;
+    for (NSUInteger c = 0; c < ALPHABET_SIZE; c++) {
+        uint32_t u = transitions[c];
+        if (u == NO_STATE) {
+            transitions[c] = 0;
+        } else {
+            fail[u] = 0;
+            outputLink[u] = NO_STATE;
+            queue[tail++] = u;
+        }
+    }
+    while (head < tail) {
+        uint32_t s = queue[head++];
+        for (NSUInteger c = 0; c < ALPHABET_SIZE; c++) {
+            uint32_t u = transitions[s * ALPHABET_SIZE + c];
+            uint32_t f = transitions[fail[s] * ALPHABET_SIZE + c];
+            if (u == NO_STATE) {
+                transitions[s * ALPHABET_SIZE + c] = f;
+            } else {
+                fail[u] = f;
+                outputLink[u] = (stateLiteral[f] >= 0) ? f : outputLink[f];
+                queue[tail++] = u;
+            }
+        }
+    }
+    
+    free(fail);
+    free(queue);
+}
+
+#pragma mark - Match
+
+// $ also matches before a line terminator at the end
+static inline BOOL IsAtEnd(const uint8_t *bytes, NSUInteger end, NSUInteger length) {
+    NSUInteger rest = length - end;
+    return (rest == 0 ||
+            (rest == 1 && (bytes[end] == '\n' || bytes[end] == '\r')) ||
+            (rest == 2 && bytes[end] == '\r' && bytes[end + 1] == '\n'));
+}
+
+- (BOOL)literalsMatchBytes:(const uint8_t *)bytes length:(NSUInteger)length {
+    uint32_t s = 0;
+    for (NSUInteger i = 0; i < length; i++) {
+        s = (bytes[i] < ALPHABET_SIZE) ? transitions[s * ALPHABET_SIZE + bytes[i]] : 0;
+        for (uint32_t t = (stateLiteral[s] >= 0) ? s : outputLink[s]; t != NO_STATE; t = outputLink[t]) {
+            for (int32_t l = stateLiteral[t]; l >= 0; l = literals[l].next) {
+                NSUInteger end = i + 1;
+                if (literals[l].anchoredStart && end != literals[l].length) {
+                    continue;
+                }
+                if (literals[l].anchoredEnd && !IsAtEnd(bytes, end, length)) {
+                    continue;
+                }
+                return YES;
+            }
+        }
+    }
+    return NO;
+}
+
+- (BOOL)matchesName:(ObjRef)name inSnapshot:(Snapshot *)snapshot {
+    if (numLiterals) {
+        NSUInteger length;
+        const char *bytes = [snapshot bytesForRef:name length:&length];
+        if (bytes && [self literalsMatchBytes:(const uint8_t *)bytes length:length]) {
+            return YES;
+        }
+    }
+    if ([regexes count]) {
+        NSString *str = [snapshot stringForRef:name];
+        for (NSRegularExpression *regex in regexes) {
+            if ([str isMatchedByRegex:regex]) {
+                return YES;
+            }
+        }
+    }
+    return NO;
+}
+
+@end
@@ -0,0 +1,86 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+@import Foundation;
+
+#import "Snapshot.h"
+#import "FilterQuery.h"
+#import "ExclusionMatcher.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class Item;
+
+// Values of all active filters, captured so that filtering
+// doesn't need to read the defaults or the interface
+@interface FilterSettings : NSObject
+
+@property BOOL showRegularFiles;
+@property BOOL showDirectories;
+@property BOOL showIPSockets;
+@property BOOL showUnixSockets;
+@property BOOL showCharDevices;
+@property BOOL showPipes;
+@property BOOL showApplicationsOnly;
+@property BOOL showHomeFolderOnly;
+@property BOOL hasVolumeFilter;
+@property dev_t volumeDevice;
+@property AccessMode accessMode; // AccessModeNone if any
+@property (strong) ExclusionMatcher *exclusionMatcher;
+@property (strong) FilterQuery *query;
+
++ (instancetype)settingsFromDefaultsWithVolume:(NSNumber * __nullable)devid
+                                  searchString:(NSString *)searchString;
+
+// Whether all filters other than the search query are the same
+- (BOOL)isEqualIgnoringQuery:(FilterSettings *)settings;
+
+@end
+
+// Filters snapshot content on a background serial queue. Each request gets
+// a generation number, evaluation of a request stops as soon as a newer one
+// is made, and only the result of the latest request is delivered.
+//
+// While only the search query changes, earlier results are kept on a stack,
+// so a query that narrows the previous one (e.g. by typing more characters
+// or adding a term) is only evaluated against the previous matches, and
+// backspacing reuses earlier results.
+@interface FilterEngine : NSObject
+
+// Completion handler is called on the main thread. Unfiltered
+// content is passed through if nothing is filtered out.
+- (void)filterContent:(NSMutableArray<Item *> *)unfilteredContent
+           ofSnapshot:(Snapshot *)snapshot
+         withSettings:(FilterSettings *)settings
+           completion:(void (^)(NSMutableArray<Item *> *content, NSInteger matchingFilesCount))completion;
+
+@end
+
+NS_ASSUME_NONNULL_END
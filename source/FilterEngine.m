@@ -0,0 +1,483 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "FilterEngine.h"
+
+#import "Common.h"
+#import "Item.h"
+#import "FilterResult.h"
+
+#import <stdatomic.h>
+
+#define MAX_REFINEMENT_DEPTH    16
+
+// Chunks of files filtered concurrently
+#define MIN_FILES_PER_CHUNK     4096
+#define CHUNKS_PER_CPU          4
+
+@implementation FilterSettings
+
++ (instancetype)settingsFromDefaultsWithVolume:(NSNumber * __nullable)devid
+                                  searchString:(NSString *)searchString {
+    FilterSettings *s = [FilterSettings new];
+    s.showRegularFiles = [DEFAULTS boolForKey:@"showRegularFiles"];
+    s.showDirectories = [DEFAULTS boolForKey:@"showDirectories"];
+    s.showIPSockets = [DEFAULTS boolForKey:@"showIPSockets"];
+    s.showUnixSockets = [DEFAULTS boolForKey:@"showUnixSockets"];
+    s.showCharDevices = [DEFAULTS boolForKey:@"showCharacterDevices"];
+    s.showPipes = [DEFAULTS boolForKey:@"showPipes"];
+    s.showApplicationsOnly = [DEFAULTS boolForKey:@"showApplicationsOnly"];
+    s.showHomeFolderOnly = [DEFAULTS boolForKey:@"showHomeFolderOnly"];
+    
+    // Access mode filter
+    NSString *accessModeFilter = [DEFAULTS stringForKey:@"accessMode"];
+    s.accessMode = AccessModeNone;
+    if ([accessModeFilter isEqualToString:@"Read"]) {
+        s.accessMode = AccessModeRead;
+    } else if ([accessModeFilter isEqualToString:@"Write"]) {
+        s.accessMode = AccessModeWrite;
+    } else if ([accessModeFilter isEqualToString:@"Read/Write"]) {
+        s.accessMode = AccessModeReadWrite;
+    }
+    
+    // Volumes filter
+    s.hasVolumeFilter = (devid != nil);
+    s.volumeDevice = (dev_t)[devid intValue];
+    
+    // Path filters such as by volume or home folder should
+    // exclude everything that isn't a file or directory
+    if (s.hasVolumeFilter || s.showHomeFolderOnly) {
+        s.showIPSockets = NO;
+        s.showUnixSockets = NO;
+        s.showCharDevices = NO;
+        s.showPipes = NO;
+    }
+    
+    // Filters set in Settings, compiled when they change
+    s.exclusionMatcher = [ExclusionMatcher currentMatcher];
+    
+    // Search field filter query
+    s.query = [FilterQuery queryWithString:searchString
+                             caseSensitive:[DEFAULTS boolForKey:@"searchFilterCaseSensitive"]
+                                     regex:[DEFAULTS boolForKey:@"searchFilterRegex"]];
+    return s;
+}
+
+- (BOOL)isEqualIgnoringQuery:(FilterSettings *)s {
+    return (_showRegularFiles == s.showRegularFiles &&
+            _showDirectories == s.showDirectories &&
+            _showIPSockets == s.showIPSockets &&
+            _showUnixSockets == s.showUnixSockets &&
+            _showCharDevices == s.showCharDevices &&
+            _showPipes == s.showPipes &&
+            _showApplicationsOnly == s.showApplicationsOnly &&
+            _showHomeFolderOnly == s.showHomeFolderOnly &&
+            _hasVolumeFilter == s.hasVolumeFilter &&
+            _volumeDevice == s.volumeDevice &&
+            _accessMode == s.accessMode &&
+            [_exclusionMatcher.patterns isEqualToArray:s.exclusionMatcher.patterns]);
+}
+
+@end
+
+#pragma mark -
+
+@interface FilterEngine ()
+{
+    dispatch_queue_t queue;
+    atomic_ulong latestGeneration;
+    
+    // Results for the current snapshot and settings, most recent last.
+    // Each is a refinement of the one below it, except the first.
+    // Only accessed on the filter queue.
+    NSMutableArray<FilterResult *> *results;
+    Snapshot *resultsSnapshot;
+    FilterSettings *resultsSettings;
+    
+    // Whether each interned name of a snapshot is excluded by the
+    // Settings filters, so that names shared by many files, such as
+    // libraries, are only matched once per snapshot. 0 if not known
+    // yet, 1 if excluded, 2 if not. Only replaced on the filter queue.
+    uint8_t *exclusionMemo;
+    Snapshot *exclusionMemoSnapshot;
+    ExclusionMatcher *exclusionMemoMatcher;
+}
+@end
+
+@implementation FilterEngine
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        queue = dispatch_queue_create("org.sveinbjorn.Sloth.filter", DISPATCH_QUEUE_SERIAL);
+        atomic_init(&latestGeneration, 0);
+        results = [NSMutableArray new];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(exclusionMemo);
+}
+
+- (BOOL)isCancelled:(unsigned long)generation {
+    return atomic_load_explicit(&latestGeneration, memory_order_relaxed) != generation;
+}
+
+- (void)filterContent:(NSMutableArray<Item *> *)unfilteredContent
+           ofSnapshot:(Snapshot *)snapshot
+         withSettings:(FilterSettings *)settings
+           completion:(void (^)(NSMutableArray<Item *> *content, NSInteger matchingFilesCount))completion {
+    unsigned long generation = atomic_fetch_add(&latestGeneration, 1) + 1;
+    
+    dispatch_async(queue, ^{
+        @autoreleasepool {
+            if ([self isCancelled:generation]) {
+                return;
+            }
+#ifdef DEBUG
+            CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+#endif
+            FilterResult *result = [self resultForSnapshot:snapshot settings:settings generation:generation];
+            if (result == nil) {
+                DLog(@"Filtering cancelled (generation %lu)", generation);
+                return;
+            }
+            NSMutableArray<Item *> *content = result.unfiltered ? unfilteredContent : [result items];
+            NSInteger count = result.fileCount;
+#ifdef DEBUG
+            DLog(@"Filtering took %.3f sec", CFAbsoluteTimeGetCurrent() - start);
+#endif
+            dispatch_async(dispatch_get_main_queue(), ^{
+                if ([self isCancelled:generation]) {
+                    return;
+                }
+                completion(content, count);
+            });
+        }
+    });
+}
+
+// Returns nil if cancelled by a newer request
+- (FilterResult * __nullable)resultForSnapshot:(Snapshot *)snapshot
+                                      settings:(FilterSettings *)settings
+                                    generation:(unsigned long)generation {
+    FilterQuery *query = settings.query;
+    
+    if (snapshot != resultsSnapshot || resultsSettings == nil || ![settings isEqualIgnoringQuery:resultsSettings]) {
+        [results removeAllObjects];
+        resultsSnapshot = snapshot;
+        resultsSettings = settings;
+    }
+    
+    // Back to an earlier query, e.g. after backspacing
+    for (NSInteger i = [results count] - 1; i >= 0; i--) {
+        FilterResult *r = results[i];
+        if ([r.query isEqualToQuery:query]) {
+            [results removeObjectsInRange:NSMakeRange(i + 1, [results count] - i - 1)];
+            DLog(@"Reusing filter results for \"%@\"", query.string);
+            return r;
+        }
+    }
+    
+    // A refinement only needs to look at the previous matches
+    FilterResult *result = nil;
+    FilterResult *previous = nil;
+    for (NSInteger i = [results count] - 1; i >= 0; i--) {
+        if ([query isRefinementOfQuery:results[i].query]) {
+            previous = results[i];
+            [results removeObjectsInRange:NSMakeRange(i + 1, [results count] - i - 1)];
+            break;
+        }
+    }
+    if (previous) {
+        DLog(@"Refining %lu filtered processes for \"%@\"", (unsigned long)previous.processCount, query.string);
+        result = [self refineResult:previous withQuery:query generation:generation];
+    } else {
+        [results removeAllObjects];
+        result = [self filterSnapshot:snapshot withSettings:settings generation:generation];
+    }
+    if (result == nil) {
+        return nil;
+    }
+    
+    result.query = query;
+    [results addObject:result];
+    if ([results count] > MAX_REFINEMENT_DEPTH) {
+        [results removeObjectAtIndex:1]; // Keep the unrefined base
+    }
+    
+#ifdef DEBUG
+    if (!query.isEmpty && [DEFAULTS boolForKey:@"benchmarkFilters"]) {
+        [query benchmarkWithSnapshot:snapshot];
+    }
+#endif
+    
+    return result;
+}
+
+// Apply only the search query to a result that already passed all other filters
+- (FilterResult * __nullable)refineResult:(FilterResult *)previous
+                                withQuery:(FilterQuery *)query
+                               generation:(unsigned long)generation {
+    FilterEvaluator *evaluator = [query evaluatorForSnapshot:previous.snapshot];
+    return [self filterResult:previous withSettings:nil evaluator:evaluator generation:generation];
+}
+
+- (FilterResult * __nullable)filterSnapshot:(Snapshot *)snapshot
+                               withSettings:(FilterSettings *)s
+                                 generation:(unsigned long)generation {
+    BOOL showAllItemTypes = (s.showRegularFiles &&
+                             s.showDirectories &&
+                             s.showIPSockets &&
+                             s.showUnixSockets &&
+                             s.showCharDevices &&
+                             s.showPipes &&
+                             !s.showHomeFolderOnly &&
+                             !s.hasVolumeFilter);
+    
+    // Minor optimization: If there is no filtering, just return
+    // unfiltered content instead of iterating over all items
+    if (showAllItemTypes && !s.showApplicationsOnly && s.query.isEmpty &&
+        s.exclusionMatcher.isEmpty && s.accessMode == AccessModeNone) {
+        return [FilterResult unfilteredResultForSnapshot:snapshot];
+    }
+    
+    FilterEvaluator *evaluator = s.query.isEmpty ? nil : [s.query evaluatorForSnapshot:snapshot];
+    return [self filterResult:[FilterResult unfilteredResultForSnapshot:snapshot]
+                 withSettings:s
+                    evaluator:evaluator
+                   generation:generation];
+}
+
+// Split the files of the source result into chunks of roughly equal size
+// and filter them concurrently. Splitting by files rather than processes
+// keeps the work balanced when a single process has most of the files.
+- (FilterResult * __nullable)filterResult:(FilterResult *)source
+                             withSettings:(FilterSettings * __nullable)s
+                                evaluator:(FilterEvaluator * __nullable)evaluator
+                               generation:(unsigned long)generation {
+    Snapshot *snapshot = source.snapshot;
+    NSUInteger numFiles = source.fileCount;
+    NSUInteger numChunks = MIN(numFiles / MIN_FILES_PER_CHUNK, [[NSProcessInfo processInfo] activeProcessorCount] * CHUNKS_PER_CPU);
+    numChunks = MAX(numChunks, 1);
+    DLog(@"Filtering %lu files in %lu chunks", (unsigned long)numFiles, (unsigned long)numChunks);
+    
+    uint8_t *settingsExcluded = NULL;
+    if (s && !s.exclusionMatcher.isEmpty) {
+        settingsExcluded = [self exclusionMemoForSnapshot:snapshot matcher:s.exclusionMatcher];
+    }
+    
+    void **parts = calloc(numChunks, sizeof(void *));
+    dispatch_apply(numChunks, DISPATCH_APPLY_AUTO, ^(size_t chunk) {
+        NSUInteger start = numFiles * chunk / numChunks;
+        NSUInteger end = numFiles * (chunk + 1) / numChunks;
+        FilterResult *part = [self filterFiles:NSMakeRange(start, end - start)
+                                      ofResult:source
+                                  withSettings:s
+                                     evaluator:evaluator
+                              settingsExcluded:settingsExcluded
+                                    generation:generation];
+        parts[chunk] = part ? (void *)CFBridgingRetain(part) : NULL;
+    });
+    NSMutableArray<FilterResult *> *results = [NSMutableArray arrayWithCapacity:numChunks];
+    BOOL cancelled = NO;
+    for (NSUInteger i = 0; i < numChunks; i++) {
+        if (parts[i] == NULL) {
+            cancelled = YES;
+            continue;
+        }
+        [results addObject:CFBridgingRelease(parts[i])];
+    }
+    free(parts);
+    if (cancelled) {
+        return nil;
+    }
+    
+    return [FilterResult resultByMergingResults:results snapshot:snapshot];
+}
+
+- (uint8_t *)exclusionMemoForSnapshot:(Snapshot *)snapshot matcher:(ExclusionMatcher *)matcher {
+    if (snapshot != exclusionMemoSnapshot || matcher != exclusionMemoMatcher) {
+        free(exclusionMemo);
+        exclusionMemo = calloc([snapshot stringCount] + 1, sizeof(uint8_t));
+        if (exclusionMemo == NULL) {
+            [NSException raise:NSMallocException format:@"Failed to allocate memory for filter"];
+        }
+        exclusionMemoSnapshot = snapshot;
+        exclusionMemoMatcher = matcher;
+    }
+    return exclusionMemo;
+}
+
+// Filter kernel for one chunk of the source result's files. Without
+// settings, only the search query is applied. Returns nil if cancelled.
+- (FilterResult * __nullable)filterFiles:(NSRange)fileRange
+                                ofResult:(FilterResult *)source
+                            withSettings:(FilterSettings * __nullable)s
+                               evaluator:(FilterEvaluator * __nullable)evaluator
+                        settingsExcluded:(uint8_t * __nullable)settingsExcluded
+                              generation:(unsigned long)generation {
+    Snapshot *snapshot = source.snapshot;
+    FilterResult *result = [[FilterResult alloc] initWithSnapshot:snapshot];
+    if (fileRange.length == 0) {
+        return result;
+    }
+    
+    BOOL showRegularFiles = s ? s.showRegularFiles : YES;
+    BOOL showDirectories = s ? s.showDirectories : YES;
+    BOOL showIPSockets = s ? s.showIPSockets : YES;
+    BOOL showUnixSockets = s ? s.showUnixSockets : YES;
+    BOOL showCharDevices = s ? s.showCharDevices : YES;
+    BOOL showPipes = s ? s.showPipes : YES;
+    BOOL showApplicationsOnly = s.showApplicationsOnly;
+    BOOL showHomeFolderOnly = s.showHomeFolderOnly;
+    BOOL hasVolumesFilter = s.hasVolumeFilter;
+    dev_t volumeDevice = s.volumeDevice;
+    AccessMode accessMode = s ? s.accessMode : AccessModeNone;
+    BOOL hasAccessModeFilter = (accessMode != AccessModeNone);
+    ExclusionMatcher *exclusionMatcher = s.exclusionMatcher;
+    
+    // User home dir path prefix
+    NSString *homeDirPath = NSHomeDirectory();
+    
+    BOOL hasSearchFilter = (evaluator != nil);
+    BOOL hasSettingsFilter = (settingsExcluded != NULL);
+    BOOL showAllItemTypes = (showRegularFiles &&
+                             showDirectories &&
+                             showIPSockets &&
+                             showUnixSockets &&
+                             showCharDevices &&
+                             showPipes &&
+                             !showHomeFolderOnly &&
+                             !hasVolumesFilter);
+    // Files of other types, e.g. errors and kqueues, are hidden when only
+    // sockets are shown, as lsof doesn't list them when selecting sockets
+    BOOL showOtherTypes = (showRegularFiles || showDirectories || showCharDevices || showPipes);
+    
+    // Iterate over each process overlapping the range, filter its files
+    const ProcessRecord *processes = snapshot.processes;
+    const FileRecord *files = snapshot.files;
+    NSUInteger rangeEnd = NSMaxRange(fileRange);
+    for (NSUInteger i = [source indexOfProcessContainingFileAtIndex:fileRange.location]; i < source.processCount; i++) {
+        NSRange range = [source fileRangeOfProcessAtIndex:i];
+        if (range.location >= rangeEnd) {
+            break;
+        }
+        range = NSIntersectionRange(range, fileRange);
+        if (range.length == 0) {
+            continue;
+        }
+        
+        if ([self isCancelled:generation]) {
+            return nil;
+        }
+        
+        NSUInteger pi = [source processAtIndex:i];
+        
+        // Skip processes that are being excluded as non-apps
+        if (showApplicationsOnly && !(processes[pi].flags & ProcessFlagApp)) {
+            continue;
+        }
+        
+        // Process-level search terms are the same for all of its files
+        FilterProcessState processState = { 0 };
+        if (hasSearchFilter && ![evaluator beginProcess:pi state:&processState]) {
+            continue;
+        }
+        
+        [result beginProcess:pi];
+        
+        for (NSUInteger j = range.location; j < NSMaxRange(range); j++) {
+            NSUInteger fi = [source fileAtIndex:j];
+            const FileRecord *f = &files[fi];
+            
+            // Let's see if file gets filtered by type or path
+            if (showAllItemTypes == NO) {
+                
+                if (showHomeFolderOnly && ![[snapshot stringForRef:f->name] hasPrefix:homeDirPath]) {
+                    continue;
+                }
+                
+                if (hasVolumesFilter) {
+                    if (!(f->flags & FileFlagHasDevice) || f->device != volumeDevice) {
+                        continue;
+                    }
+                }
+                
+                BOOL showType = YES;
+                switch (f->type) {
+                    case FileTypeFile:          showType = showRegularFiles; break;
+                    case FileTypeDirectory:     showType = showDirectories; break;
+                    case FileTypeIPSocket:      showType = showIPSockets; break;
+                    case FileTypeUnixSocket:    showType = showUnixSockets; break;
+                    case FileTypeCharDevice:    showType = showCharDevices; break;
+                    case FileTypePipe:          showType = showPipes; break;
+                    default:                    showType = showOtherTypes; break;
+                }
+                if (!showType) {
+                    continue;
+                }
+            }
+            
+            // Filter by access mode
+            if (hasAccessModeFilter && f->accessMode != accessMode) {
+                continue;
+            }
+            
+            // See if it matches the search field query
+            if (hasSearchFilter && ![evaluator matchesFile:fi process:&processState]) {
+                continue;
+            }
+            
+            // Settings filters only filter by name
+            if (hasSettingsFilter && f->name != NO_REF) {
+                // Skip any file w. name matching. Other chunks may
+                // store the same value for the same name concurrently.
+                uint8_t excluded = __atomic_load_n(&settingsExcluded[f->name], __ATOMIC_RELAXED);
+                if (excluded == 0) {
+                    excluded = [exclusionMatcher matchesName:f->name inSnapshot:snapshot] ? 1 : 2;
+                    __atomic_store_n(&settingsExcluded[f->name], excluded, __ATOMIC_RELAXED);
+                }
+                if (excluded == 1) {
+                    continue;
+                }
+            }
+            
+            [result addFile:fi];
+        }
+        
+        [result endProcess];
+    }
+    
+    return result;
+}
+
+@end
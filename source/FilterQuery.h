@@ -0,0 +1,88 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class Snapshot;
+@class FilterEvaluator;
+
+// Search filter query, compiled into predicates over snapshot records.
+// Space-separated terms must all match, terms joined by OR (or |) match if
+// any of them does, and a term prefixed with - matches if it doesn't.
+// Terms can be restricted to a field:
+//
+//   pid:123 ppid:1 user:www type:ip port:443 proto:tcp state:CLOSE_WAIT
+//   mode:w fd:cwd pname:Safari name:*.dylib path:/var/log/*
+//
+// Other terms match file name, process name or PID, and in regex mode also
+// protocol, IP version and socket state. String values containing * ? or [
+// are matched as globs, and all string values are regexes in regex mode.
+@interface FilterQuery : NSObject
+
+@property (readonly, copy) NSString *string;
+@property (readonly) BOOL caseSensitive;
+@property (readonly) BOOL regex;
+@property (readonly) BOOL isEmpty;
+
++ (instancetype)queryWithString:(NSString *)string caseSensitive:(BOOL)caseSensitive regex:(BOOL)regex;
+
+- (BOOL)isEqualToQuery:(FilterQuery *)query;
+
+// Whether everything matching this query also matches the other one,
+// e.g. when a search term has been made longer or a term has been added
+- (BOOL)isRefinementOfQuery:(FilterQuery *)query;
+
+- (FilterEvaluator *)evaluatorForSnapshot:(Snapshot *)snapshot;
+
+#ifdef DEBUG
+- (void)benchmarkWithSnapshot:(Snapshot *)snapshot;
+#endif
+
+@end
+
+// Results of process-level terms, which are the same for all of its files
+typedef struct {
+    uint64_t matched;
+} FilterProcessState;
+
+// Evaluates a query against a single snapshot. Results for string fields
+// are cached per interned string, so each distinct value is tested once.
+// Can be used from several threads at once.
+@interface FilterEvaluator : NSObject
+
+// Returns NO if none of the process's files can match
+- (BOOL)beginProcess:(NSUInteger)processIndex state:(FilterProcessState *)state;
+- (BOOL)matchesFile:(NSUInteger)fileIndex process:(const FilterProcessState *)state;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,749 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "FilterQuery.h"
+
+#import "Common.h"
+#import "Snapshot.h"
+#import "TrigramIndex.h"
+#import "NSString+RegexConvenience.h"
+
+#import <fnmatch.h>
+#import <netdb.h>
+#import <pwd.h>
+
+#define MAX_FILTER_TERMS    64
+
+typedef NS_ENUM(uint8_t, FilterField) {
+    FilterFieldAny = 0, // File name, process name or PID
+    FilterFieldPID,
+    FilterFieldPPID,
+    FilterFieldUser,
+    FilterFieldType,
+    FilterFieldMode,
+    FilterFieldPort,
+    FilterFieldProtocol,
+    FilterFieldState,
+    FilterFieldFD,
+    FilterFieldName,
+    FilterFieldProcessName
+};
+
+typedef NS_ENUM(uint8_t, StringMatch) {
+    StringMatchNone = 0,
+    StringMatchSubstring,
+    StringMatchExact,
+    StringMatchGlob,
+    StringMatchRegex
+};
+
+// Cached result of a string term for an interned string
+enum {
+    MemoUnknown = 0,
+    MemoNoMatch,
+    MemoMatch
+};
+
+typedef struct {
+    FilterField field;
+    StringMatch match;
+    BOOL negated;
+    BOOL processLevel;  // Depends only on the process, not the file
+    BOOL numeric;       // fd: compares the descriptor number
+    uint8_t cost;
+    IPVersion ipVersion;
+    int64_t number;     // PID, UID, port, FileType or AccessMode
+    NSUInteger clause;
+    __unsafe_unretained id pattern; // NSString or NSRegularExpression
+    const char *glob;
+} FilterTerm;
+
+static NSDictionary<NSString*, NSNumber*> *FieldNames(void) {
+    static NSDictionary *fieldNames;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        fieldNames = @{
+            @"pid": @(FilterFieldPID),
+            @"ppid": @(FilterFieldPPID),
+            @"user": @(FilterFieldUser),
+            @"uid": @(FilterFieldUser),
+            @"type": @(FilterFieldType),
+            @"mode": @(FilterFieldMode),
+            @"port": @(FilterFieldPort),
+            @"proto": @(FilterFieldProtocol),
+            @"protocol": @(FilterFieldProtocol),
+            @"state": @(FilterFieldState),
+            @"fd": @(FilterFieldFD),
+            @"name": @(FilterFieldName),
+            @"path": @(FilterFieldName),
+            @"pname": @(FilterFieldProcessName),
+            @"process": @(FilterFieldProcessName)
+        };
+    });
+    return fieldNames;
+}
+
+static BOOL ParseInteger(NSString *str, int64_t *value) {
+    NSScanner *scanner = [NSScanner scannerWithString:str];
+    long long n;
+    if (![scanner scanLongLong:&n] || ![scanner isAtEnd]) {
+        return NO;
+    }
+    *value = n;
+    return YES;
+}
+
+// Split on whitespace, keeping double-quoted strings together
+static NSArray<NSString *> *Tokenize(NSString *string) {
+    NSMutableArray<NSString *> *tokens = [NSMutableArray new];
+    NSMutableString *token = [NSMutableString new];
+    NSCharacterSet *whitespace = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    BOOL quoted = NO;
+    for (NSUInteger i = 0; i < [string length]; i++) {
+        unichar c = [string characterAtIndex:i];
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (!quoted && [whitespace characterIsMember:c]) {
+            if ([token length]) {
+                [tokens addObject:[token copy]];
+                [token setString:@""];
+            }
+        } else {
+            [token appendFormat:@"%C", c];
+        }
+    }
+    if ([token length]) {
+        [tokens addObject:[token copy]];
+    }
+    return tokens;
+}
+
+@interface FilterQuery ()
+{
+@package
+    FilterTerm *terms;
+    NSUInteger numTerms;
+    
+    // Terms are grouped by clause, clause c ends at clauseEnd[c]
+    NSUInteger *clauseEnd;
+    BOOL *clauseProcessOnly;
+    NSUInteger numClauses;
+    
+    // Strong references to patterns used by terms
+    NSMutableArray *patterns;
+}
+@end
+
+@interface FilterEvaluator ()
+- (instancetype)initWithQuery:(FilterQuery *)query snapshot:(Snapshot *)snapshot;
+@end
+
+@implementation FilterQuery
+
++ (instancetype)queryWithString:(NSString *)string caseSensitive:(BOOL)caseSensitive regex:(BOOL)regex {
+    return [[FilterQuery alloc] initWithString:string caseSensitive:caseSensitive regex:regex];
+}
+
+- (instancetype)initWithString:(NSString *)string caseSensitive:(BOOL)caseSensitive regex:(BOOL)regex {
+    self = [super init];
+    if (self) {
+        _string = [string copy];
+        _caseSensitive = caseSensitive;
+        _regex = regex;
+        patterns = [NSMutableArray new];
+        terms = calloc(MAX_FILTER_TERMS, sizeof(FilterTerm));
+        [self compile];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(terms);
+    free(clauseEnd);
+    free(clauseProcessOnly);
+}
+
+- (BOOL)isEmpty {
+    return (numClauses == 0);
+}
+
+#pragma mark - Compile
+
+- (void)compile {
+    BOOL joinWithPrevious = NO;
+    for (NSString *token in Tokenize(_string)) {
+        if ([token isEqualToString:@"OR"] || [token isEqualToString:@"|"]) {
+            joinWithPrevious = (numTerms > 0);
+            continue;
+        }
+        if (numTerms == MAX_FILTER_TERMS) {
+            DLog(@"Ignoring filter terms beyond the first %d", MAX_FILTER_TERMS);
+            break;
+        }
+        FilterTerm term;
+        if (![self parseTerm:token into:&term]) {
+            joinWithPrevious = NO;
+            continue;
+        }
+        term.clause = joinWithPrevious ? numClauses - 1 : numClauses++;
+        terms[numTerms++] = term;
+        joinWithPrevious = NO;
+    }
+    
+    // Cheap tests run first. Clauses are ordered by their most
+    // expensive term, and terms within a clause by cost.
+    uint8_t *clauseCost = calloc(MAX(numClauses, 1), sizeof(uint8_t));
+    for (NSUInteger i = 0; i < numTerms; i++) {
+        clauseCost[terms[i].clause] = MAX(clauseCost[terms[i].clause], terms[i].cost);
+    }
+    qsort_b(terms, numTerms, sizeof(FilterTerm), ^int(const void *a, const void *b) {
+        const FilterTerm *ta = a, *tb = b;
+        if (clauseCost[ta->clause] != clauseCost[tb->clause]) {
+            return clauseCost[ta->clause] < clauseCost[tb->clause] ? -1 : 1;
+        }
+        if (ta->clause != tb->clause) {
+            return ta->clause < tb->clause ? -1 : 1;
+        }
+        return (ta->cost > tb->cost) - (ta->cost < tb->cost);
+    });
+    free(clauseCost);
+    
+    // Renumber clauses in their new order
+    clauseEnd = calloc(MAX(numClauses, 1), sizeof(NSUInteger));
+    clauseProcessOnly = calloc(MAX(numClauses, 1), sizeof(BOOL));
+    NSUInteger c = 0;
+    NSUInteger previous = NSNotFound;
+    for (NSUInteger i = 0; i < numTerms; i++) {
+        if (terms[i].clause != previous) {
+            if (previous != NSNotFound) {
+                c++;
+            }
+            clauseProcessOnly[c] = YES;
+            previous = terms[i].clause;
+        }
+        terms[i].clause = c;
+        clauseProcessOnly[c] = clauseProcessOnly[c] && terms[i].processLevel;
+        clauseEnd[c] = i + 1;
+    }
+}
+
+- (BOOL)parseTerm:(NSString *)token into:(FilterTerm *)t {
+    memset(t, 0, sizeof(FilterTerm));
+    
+    if ([token length] > 1 && [token hasPrefix:@"-"]) {
+        t->negated = YES;
+        token = [token substringFromIndex:1];
+    }
+    
+    // Tokens such as host:port are matched as a whole
+    // unless the part before the colon is a known field
+    NSString *value = token;
+    NSRange colon = [token rangeOfString:@":"];
+    if (colon.location != NSNotFound && colon.location > 0) {
+        NSNumber *field = FieldNames()[[[token substringToIndex:colon.location] lowercaseString]];
+        if (field) {
+            t->field = [field unsignedCharValue];
+            value = [token substringFromIndex:colon.location + 1];
+        }
+    }
+    if ([value length] == 0) {
+        return NO;
+    }
+    
+    switch (t->field) {
+        case FilterFieldPID:
+        case FilterFieldPPID:
+            t->processLevel = YES;
+            return ParseInteger(value, &t->number);
+            
+        case FilterFieldUser:
+            t->processLevel = YES;
+            if (!ParseInteger(value, &t->number)) {
+                struct passwd *pw = getpwnam([value UTF8String]);
+                t->number = pw ? pw->pw_uid : -1; // Unknown users match nothing
+            }
+            return YES;
+            
+        case FilterFieldType:
+            return [self parseType:[value lowercaseString] into:t];
+            
+        case FilterFieldMode:
+        {
+            NSDictionary *modes = @{ @"r": @(AccessModeRead), @"read": @(AccessModeRead),
+                                     @"w": @(AccessModeWrite), @"write": @(AccessModeWrite),
+                                     @"u": @(AccessModeReadWrite), @"rw": @(AccessModeReadWrite) };
+            NSNumber *mode = modes[[value lowercaseString]];
+            t->number = mode ? [mode integerValue] : -1;
+            return (mode != nil);
+        }
+            
+        case FilterFieldPort:
+        {
+            // Port names are shown if lsof does port lookups, so match both
+            struct servent *se = NULL;
+            if (ParseInteger(value, &t->number)) {
+                se = getservbyport(htons((uint16_t)t->number), NULL);
+            } else {
+                se = getservbyname([value UTF8String], NULL);
+                t->number = se ? ntohs((uint16_t)se->s_port) : -1;
+            }
+            NSString *serviceName = se ? @(se->s_name) : value;
+            [patterns addObject:serviceName];
+            t->pattern = serviceName;
+            t->cost = 1;
+            return YES;
+        }
+            
+        case FilterFieldFD:
+            if (ParseInteger(value, &t->number)) {
+                t->numeric = YES;
+                return YES;
+            }
+            return [self parseStringValue:value into:t];
+            
+        case FilterFieldProcessName:
+            t->processLevel = YES;
+            return [self parseStringValue:value into:t];
+            
+        default:
+            return [self parseStringValue:value into:t];
+    }
+}
+
+- (BOOL)parseType:(NSString *)value into:(FilterTerm *)t {
+    NSDictionary *types = @{ @"file": @(FileTypeFile), @"reg": @(FileTypeFile),
+                             @"dir": @(FileTypeDirectory),
+                             @"ip": @(FileTypeIPSocket), @"ipv4": @(FileTypeIPSocket), @"ipv6": @(FileTypeIPSocket),
+                             @"unix": @(FileTypeUnixSocket),
+                             @"char": @(FileTypeCharDevice), @"chr": @(FileTypeCharDevice),
+                             @"pipe": @(FileTypePipe) };
+    NSNumber *type = types[value];
+    if (type == nil) {
+        DLog(@"Unknown file type in filter: %@", value);
+        return NO;
+    }
+    t->number = [type integerValue];
+    if ([value isEqualToString:@"ipv4"]) {
+        t->ipVersion = IPVersion4;
+    } else if ([value isEqualToString:@"ipv6"]) {
+        t->ipVersion = IPVersion6;
+    }
+    return YES;
+}
+
+- (BOOL)parseStringValue:(NSString *)value into:(FilterTerm *)t {
+    if (_regex) {
+        NSError *err;
+        NSRegularExpressionOptions options = _caseSensitive ? 0 : NSRegularExpressionCaseInsensitive;
+        NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:value
+                                                                               options:options
+                                                                                 error:&err];
+        if (!regex) {
+            DLog(@"Error creating search filter regex: %@", [err localizedDescription]);
+            return NO;
+        }
+        [patterns addObject:regex];
+        t->pattern = regex;
+        t->match = StringMatchRegex;
+        t->cost = 3;
+    } else if ([value rangeOfCharacterFromSet:[NSCharacterSet characterSetWithCharactersInString:@"*?["]].location != NSNotFound) {
+        NSData *glob = [NSData dataWithBytes:[value UTF8String] length:strlen([value UTF8String]) + 1];
+        [patterns addObject:glob];
+        t->glob = [glob bytes];
+        t->match = StringMatchGlob;
+        t->cost = 2;
+    } else {
+        [patterns addObject:value];
+        t->pattern = value;
+        BOOL exact = (t->field == FilterFieldProtocol || t->field == FilterFieldState || t->field == FilterFieldFD);
+        t->match = exact ? StringMatchExact : StringMatchSubstring;
+        t->cost = 2;
+    }
+    // Matched against several fields
+    if (t->field == FilterFieldAny) {
+        t->cost += 1;
+    }
+    return YES;
+}
+
+#pragma mark - Compare
+
+- (BOOL)isEqualToQuery:(FilterQuery *)query {
+    return ([_string isEqualToString:query.string] &&
+            _caseSensitive == query.caseSensitive &&
+            _regex == query.regex);
+}
+
+// Whether term a matching implies term b matching
+static BOOL TermImplies(const FilterTerm *a, const FilterTerm *b, BOOL caseSensitive) {
+    if (a->field != b->field || a->negated != b->negated || a->match != b->match ||
+        a->numeric != b->numeric || a->number != b->number || a->ipVersion != b->ipVersion) {
+        return NO;
+    }
+    switch (a->match) {
+        case StringMatchNone:
+            return (a->pattern == b->pattern || [a->pattern isEqual:b->pattern]);
+        case StringMatchSubstring:
+        {
+            // Containing a longer string implies containing any part of it,
+            // and not containing a shorter one implies not containing any
+            // string that contains it
+            NSString *longer = a->negated ? b->pattern : a->pattern;
+            NSString *shorter = a->negated ? a->pattern : b->pattern;
+            NSStringCompareOptions options = caseSensitive ? 0 : NSCaseInsensitiveSearch;
+            return [longer rangeOfString:shorter options:options].location != NSNotFound;
+        }
+        case StringMatchExact:
+            return [a->pattern isEqualToString:b->pattern];
+        case StringMatchGlob:
+            return strcmp(a->glob, b->glob) == 0;
+        case StringMatchRegex:
+            return [[a->pattern pattern] isEqualToString:[b->pattern pattern]];
+    }
+    return NO;
+}
+
+- (BOOL)isRefinementOfQuery:(FilterQuery *)query {
+    if (_caseSensitive != query.caseSensitive || _regex != query.regex) {
+        return NO;
+    }
+    
+    // Each clause of the other query must be implied by one of ours.
+    // A clause implies another if each of its terms implies one of the other's.
+    NSUInteger start = 0;
+    for (NSUInteger c = 0; c < query->numClauses; c++) {
+        BOOL implied = NO;
+        NSUInteger ourStart = 0;
+        for (NSUInteger d = 0; d < numClauses && !implied; d++) {
+            implied = YES;
+            for (NSUInteger i = ourStart; i < clauseEnd[d] && implied; i++) {
+                BOOL termImplied = NO;
+                for (NSUInteger j = start; j < query->clauseEnd[c] && !termImplied; j++) {
+                    termImplied = TermImplies(&terms[i], &query->terms[j], _caseSensitive);
+                }
+                implied = termImplied;
+            }
+            ourStart = clauseEnd[d];
+        }
+        if (!implied) {
+            return NO;
+        }
+        start = query->clauseEnd[c];
+    }
+    return YES;
+}
+
+#pragma mark - Evaluate
+
+- (FilterEvaluator *)evaluatorForSnapshot:(Snapshot *)snapshot {
+    return [[FilterEvaluator alloc] initWithQuery:self snapshot:snapshot];
+}
+
+#ifdef DEBUG
+- (void)benchmarkWithSnapshot:(Snapshot *)snapshot {
+    NSUInteger fileCount = [snapshot fileCount];
+    if (fileCount == 0) {
+        return;
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        // First pass fills the string caches, the second reuses them
+        FilterEvaluator *evaluator = [self evaluatorForSnapshot:snapshot];
+        NSUInteger matches = 0;
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        for (int run = 0; run <= pass; run++) {
+            matches = 0;
+            if (run == 1) {
+                start = CFAbsoluteTimeGetCurrent();
+            }
+            for (NSUInteger i = 0; i < [snapshot processCount]; i++) {
+                FilterProcessState state;
+                if (![evaluator beginProcess:i state:&state]) {
+                    continue;
+                }
+                const ProcessRecord *p = &snapshot.processes[i];
+                for (NSUInteger f = p->firstFile; f < p->firstFile + p->numFiles; f++) {
+                    matches += [evaluator matchesFile:f process:&state];
+                }
+            }
+        }
+        CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+        DLog(@"Filter \"%@\" (%@): %lu of %lu files match, %.1f ms per million fds",
+             _string, pass ? @"cached" : @"uncached", (unsigned long)matches, (unsigned long)fileCount,
+             elapsed * 1000.0 * (1000000.0 / fileCount));
+    }
+}
+#endif
+
+@end
+
+#pragma mark -
+
+@interface FilterEvaluator ()
+{
+    FilterQuery *query;
+    Snapshot *snapshot;
+    const FilterTerm *terms;
+    NSUInteger numTerms;
+    const NSUInteger *clauseEnd;
+    const BOOL *clauseProcessOnly;
+    NSUInteger numClauses;
+    
+    // Per-term results for each interned string, NULL for non-string terms
+    uint8_t **memos;
+    
+    // Regex bare terms also match the IP version
+    uint64_t ipv4Matches;
+    uint64_t ipv6Matches;
+}
+@end
+
+@implementation FilterEvaluator
+
+- (instancetype)initWithQuery:(FilterQuery *)q snapshot:(Snapshot *)s {
+    self = [super init];
+    if (self) {
+        query = q;
+        snapshot = s;
+        terms = q->terms;
+        numTerms = q->numTerms;
+        clauseEnd = q->clauseEnd;
+        clauseProcessOnly = q->clauseProcessOnly;
+        numClauses = q->numClauses;
+        
+        NSUInteger numStrings = [s stringCount] + 1;
+        memos = calloc(MAX(numTerms, 1), sizeof(uint8_t *));
+        for (NSUInteger i = 0; i < numTerms; i++) {
+            if (terms[i].match != StringMatchNone || terms[i].field == FilterFieldPort) {
+                memos[i] = calloc(numStrings, sizeof(uint8_t));
+            }
+            // Rule out names that can't contain a substring term up front
+            if (terms[i].match == StringMatchSubstring &&
+                (terms[i].field == FilterFieldAny || terms[i].field == FilterFieldName || terms[i].field == FilterFieldProcessName)) {
+                [[TrigramIndex sharedIndex] markStrings:memos[i]
+                                             ofSnapshot:s
+                                          notContaining:terms[i].pattern
+                                                  value:MemoNoMatch];
+            }
+            if (terms[i].field == FilterFieldAny && terms[i].match == StringMatchRegex) {
+                if ([self term:&terms[i] matchesString:@"IPv4"]) {
+                    ipv4Matches |= ((uint64_t)1 << i);
+                }
+                if ([self term:&terms[i] matchesString:@"IPv6"]) {
+                    ipv6Matches |= ((uint64_t)1 << i);
+                }
+            }
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (NSUInteger i = 0; i < numTerms; i++) {
+        free(memos[i]);
+    }
+    free(memos);
+}
+
+#pragma mark - String matching
+
+- (BOOL)term:(const FilterTerm *)t matchesString:(NSString *)str {
+    if (str == nil) {
+        return NO;
+    }
+    NSStringCompareOptions options = query.caseSensitive ? 0 : NSCaseInsensitiveSearch;
+    switch (t->match) {
+        case StringMatchSubstring:
+            return [str rangeOfString:t->pattern options:options].location != NSNotFound;
+        case StringMatchExact:
+            return [str compare:t->pattern options:options] == NSOrderedSame;
+        case StringMatchRegex:
+            return [str isMatchedByRegex:t->pattern];
+        case StringMatchGlob:
+            return fnmatch(t->glob, [str UTF8String], query.caseSensitive ? 0 : FNM_CASEFOLD) == 0;
+        case StringMatchNone:
+            break;
+    }
+    return NO;
+}
+
+// Match any port in a socket name such as 10.0.0.1:443->10.0.0.2:50000
+- (BOOL)portTerm:(const FilterTerm *)t matchesName:(NSString *)name {
+    for (NSString *endpoint in [name componentsSeparatedByString:@"->"]) {
+        NSRange colon = [endpoint rangeOfString:@":" options:NSBackwardsSearch];
+        if (colon.location == NSNotFound) {
+            continue;
+        }
+        NSString *port = [endpoint substringFromIndex:colon.location + 1];
+        int64_t number;
+        if (ParseInteger(port, &number) ? (number == t->number) : [port isEqualToString:t->pattern]) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+static inline BOOL MemoizedMatch(FilterEvaluator *self, NSUInteger i, ObjRef ref) {
+    if (ref == NO_REF) {
+        return NO;
+    }
+    uint8_t *memo = self->memos[i];
+    uint8_t result = __atomic_load_n(&memo[ref], __ATOMIC_RELAXED);
+    if (result == MemoUnknown) {
+        const FilterTerm *t = &self->terms[i];
+        NSString *str = [self->snapshot stringForRef:ref];
+        BOOL match = (t->field == FilterFieldPort) ? [self portTerm:t matchesName:str] : [self term:t matchesString:str];
+        result = match ? MemoMatch : MemoNoMatch;
+        __atomic_store_n(&memo[ref], result, __ATOMIC_RELAXED);
+    }
+    return (result == MemoMatch);
+}
+
+#pragma mark - Evaluation
+
+static inline BOOL ClauseMatches(FilterEvaluator *self, NSUInteger c, NSUInteger start, uint64_t matched) {
+    for (NSUInteger i = start; i < self->clauseEnd[c]; i++) {
+        BOOL match = (matched >> i) & 1;
+        if (match != self->terms[i].negated) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+- (BOOL)beginProcess:(NSUInteger)processIndex state:(FilterProcessState *)state {
+    const ProcessRecord *p = &snapshot.processes[processIndex];
+    ObjRef pname = (p->pname != NO_REF) ? p->pname : p->name;
+    NSString *pidString = nil;
+    uint64_t matched = 0;
+    
+    for (NSUInteger i = 0; i < numTerms; i++) {
+        const FilterTerm *t = &terms[i];
+        BOOL match = NO;
+        switch (t->field) {
+            case FilterFieldPID:
+                match = (p->pid == t->number);
+                break;
+            case FilterFieldPPID:
+                match = (p->ppid == t->number);
+                break;
+            case FilterFieldUser:
+                match = ((int64_t)p->uid == t->number);
+                break;
+            case FilterFieldProcessName:
+                match = MemoizedMatch(self, i, pname);
+                break;
+            case FilterFieldAny:
+                match = MemoizedMatch(self, i, pname);
+                if (!match) {
+                    if (pidString == nil) {
+                        pidString = [NSString stringWithFormat:@"%d", p->pid];
+                    }
+                    match = [self term:t matchesString:pidString];
+                }
+                break;
+            default:
+                break;
+        }
+        if (match) {
+            matched |= ((uint64_t)1 << i);
+        }
+    }
+    state->matched = matched;
+    
+    // Clauses of only process-level terms decide for all files
+    NSUInteger start = 0;
+    for (NSUInteger c = 0; c < numClauses; c++) {
+        if (clauseProcessOnly[c] && !ClauseMatches(self, c, start, matched)) {
+            return NO;
+        }
+        start = clauseEnd[c];
+    }
+    return YES;
+}
+
+- (BOOL)matchesFile:(NSUInteger)fileIndex process:(const FilterProcessState *)state {
+    const FileRecord *f = &snapshot.files[fileIndex];
+    NSUInteger i = 0;
+    
+    for (NSUInteger c = 0; c < numClauses; c++) {
+        BOOL clauseMatched = NO;
+        for (; i < clauseEnd[c] && !clauseMatched; i++) {
+            const FilterTerm *t = &terms[i];
+            BOOL match = NO;
+            switch (t->field) {
+                case FilterFieldPID:
+                case FilterFieldPPID:
+                case FilterFieldUser:
+                case FilterFieldProcessName:
+                    match = (state->matched >> i) & 1;
+                    break;
+                case FilterFieldType:
+                    match = (f->type == t->number && (t->ipVersion == IPVersionNone || f->ipVersion == t->ipVersion));
+                    break;
+                case FilterFieldMode:
+                    match = (f->accessMode == t->number);
+                    break;
+                case FilterFieldPort:
+                    match = (f->type == FileTypeIPSocket && MemoizedMatch(self, i, f->name));
+                    break;
+                case FilterFieldProtocol:
+                    match = MemoizedMatch(self, i, f->protocol);
+                    break;
+                case FilterFieldState:
+                    match = MemoizedMatch(self, i, f->socketState);
+                    break;
+                case FilterFieldFD:
+                    match = t->numeric ? (f->fd == t->number) : MemoizedMatch(self, i, f->fdName);
+                    break;
+                case FilterFieldName:
+                    match = MemoizedMatch(self, i, f->name);
+                    break;
+                case FilterFieldAny:
+                    match = ((state->matched >> i) & 1) || MemoizedMatch(self, i, f->name);
+                    if (!match && t->match == StringMatchRegex) {
+                        // Regex search also matches protocol, IP version and socket state
+                        match = (MemoizedMatch(self, i, f->protocol) ||
+                                 MemoizedMatch(self, i, f->socketState) ||
+                                 (f->ipVersion == IPVersion4 && ((ipv4Matches >> i) & 1)) ||
+                                 (f->ipVersion == IPVersion6 && ((ipv6Matches >> i) & 1)));
+                    }
+                    break;
+            }
+            clauseMatched = (match != t->negated);
+        }
+        if (!clauseMatched) {
+            return NO;
+        }
+        i = clauseEnd[c];
+    }
+    return YES;
+}
+
+@end
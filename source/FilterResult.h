@@ -0,0 +1,76 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class Snapshot;
+@class Item;
+@class FilterQuery;
+
+// Processes and files matching the filters, as indices into a snapshot.
+// Each matching process is stored with the range of its matching files.
+@interface FilterResult : NSObject
+
+@property (readonly, strong) Snapshot *snapshot;
+@property (strong, nullable) FilterQuery *query;
+@property (readonly) NSUInteger processCount;
+@property (readonly) NSUInteger fileCount;
+
+// All processes and files, without filtering
+@property (readonly) BOOL unfiltered;
+
+- (instancetype)initWithSnapshot:(Snapshot *)snapshot;
++ (instancetype)unfilteredResultForSnapshot:(Snapshot *)snapshot;
+
+// Concatenate results for consecutive ranges of the same source, in order.
+// A process whose files were split between two parts is joined again.
++ (instancetype)resultByMergingResults:(NSArray<FilterResult *> *)parts snapshot:(Snapshot *)snapshot;
+
+// Files must be added between beginProcess: and endProcess.
+// Processes without any matching files are discarded.
+- (void)beginProcess:(NSUInteger)processIndex;
+- (void)addFile:(NSUInteger)fileIndex;
+- (void)endProcess;
+
+- (NSUInteger)processAtIndex:(NSUInteger)i;
+- (NSRange)fileRangeOfProcessAtIndex:(NSUInteger)i;
+- (NSUInteger)fileAtIndex:(NSUInteger)i;
+
+// Index of the process whose file range contains the i-th file
+- (NSUInteger)indexOfProcessContainingFileAtIndex:(NSUInteger)i;
+
+// Process items viewing this result, see Item
+- (NSMutableArray<Item *> *)items;
+
+@end
+
+NS_ASSUME_NONNULL_END
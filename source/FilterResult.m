@@ -0,0 +1,199 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "FilterResult.h"
+
+#import "Snapshot.h"
+#import "Item.h"
+
+#define INITIAL_PROCESS_CAPACITY    64
+#define INITIAL_FILE_CAPACITY       1024
+
+@interface FilterResult ()
+{
+    uint32_t *processes;
+    uint32_t *fileStarts; // Start of each process's files, one extra at end
+    uint32_t *files;
+    NSUInteger processCapacity;
+    NSUInteger fileCapacity;
+}
+@end
+
+@implementation FilterResult
+
+- (instancetype)initWithSnapshot:(Snapshot *)snapshot {
+    self = [super init];
+    if (self) {
+        _snapshot = snapshot;
+        processCapacity = INITIAL_PROCESS_CAPACITY;
+        fileCapacity = INITIAL_FILE_CAPACITY;
+        processes = malloc(processCapacity * sizeof(uint32_t));
+        fileStarts = malloc((processCapacity + 1) * sizeof(uint32_t));
+        files = malloc(fileCapacity * sizeof(uint32_t));
+        if (processes == NULL || fileStarts == NULL || files == NULL) {
+            [NSException raise:NSMallocException format:@"Failed to allocate memory for filter result"];
+        }
+        fileStarts[0] = 0;
+    }
+    return self;
+}
+
++ (instancetype)unfilteredResultForSnapshot:(Snapshot *)snapshot {
+    FilterResult *result = [[FilterResult alloc] initWithSnapshot:snapshot];
+    result->_unfiltered = YES;
+    result->_processCount = [snapshot processCount];
+    result->_fileCount = [snapshot fileCount];
+    return result;
+}
+
++ (instancetype)resultByMergingResults:(NSArray<FilterResult *> *)parts snapshot:(Snapshot *)snapshot {
+    FilterResult *result = [[FilterResult alloc] initWithSnapshot:snapshot];
+    for (FilterResult *part in parts) {
+        [result appendResult:part];
+    }
+    return result;
+}
+
+- (void)dealloc {
+    free(processes);
+    free(fileStarts);
+    free(files);
+}
+
+#pragma mark - Build
+
+- (void)beginProcess:(NSUInteger)processIndex {
+    if (_processCount == processCapacity) {
+        processCapacity *= 2;
+        processes = realloc(processes, processCapacity * sizeof(uint32_t));
+        fileStarts = realloc(fileStarts, (processCapacity + 1) * sizeof(uint32_t));
+        if (processes == NULL || fileStarts == NULL) {
+            [NSException raise:NSMallocException format:@"Failed to allocate memory for filter result"];
+        }
+    }
+    processes[_processCount] = (uint32_t)processIndex;
+}
+
+- (void)addFile:(NSUInteger)fileIndex {
+    if (_fileCount == fileCapacity) {
+        fileCapacity *= 2;
+        files = realloc(files, fileCapacity * sizeof(uint32_t));
+        if (files == NULL) {
+            [NSException raise:NSMallocException format:@"Failed to allocate memory for filter result"];
+        }
+    }
+    files[_fileCount++] = (uint32_t)fileIndex;
+}
+
+- (void)endProcess {
+    if (_fileCount > fileStarts[_processCount]) {
+        _processCount++;
+        fileStarts[_processCount] = (uint32_t)_fileCount;
+    }
+}
+
+- (void)appendResult:(FilterResult *)part {
+    if (part.processCount == 0) {
+        return;
+    }
+    
+    // Continue the last process if the part starts with the rest of its files
+    if (_processCount && processes[_processCount - 1] == part->processes[0]) {
+        _processCount--;
+    }
+    
+    NSUInteger newProcessCount = _processCount + part.processCount;
+    NSUInteger newFileCount = _fileCount + part.fileCount;
+    if (newProcessCount > processCapacity) {
+        processCapacity = MAX(processCapacity * 2, newProcessCount);
+        processes = realloc(processes, processCapacity * sizeof(uint32_t));
+        fileStarts = realloc(fileStarts, (processCapacity + 1) * sizeof(uint32_t));
+    }
+    if (newFileCount > fileCapacity) {
+        fileCapacity = MAX(fileCapacity * 2, newFileCount);
+        files = realloc(files, fileCapacity * sizeof(uint32_t));
+    }
+    if (processes == NULL || fileStarts == NULL || files == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for filter result"];
+    }
+    
+    memcpy(&processes[_processCount], part->processes, part.processCount * sizeof(uint32_t));
+    for (NSUInteger i = 0; i < part.processCount; i++) {
+        fileStarts[_processCount + i + 1] = (uint32_t)(_fileCount + part->fileStarts[i + 1]);
+    }
+    memcpy(&files[_fileCount], part->files, part.fileCount * sizeof(uint32_t));
+    
+    _processCount = newProcessCount;
+    _fileCount = newFileCount;
+}
+
+#pragma mark - Access
+
+- (NSUInteger)processAtIndex:(NSUInteger)i {
+    return _unfiltered ? i : processes[i];
+}
+
+- (NSRange)fileRangeOfProcessAtIndex:(NSUInteger)i {
+    if (_unfiltered) {
+        const ProcessRecord *p = &_snapshot.processes[i];
+        return NSMakeRange(p->firstFile, p->numFiles);
+    }
+    return NSMakeRange(fileStarts[i], fileStarts[i + 1] - fileStarts[i]);
+}
+
+- (NSUInteger)fileAtIndex:(NSUInteger)i {
+    return _unfiltered ? i : files[i];
+}
+
+- (NSUInteger)indexOfProcessContainingFileAtIndex:(NSUInteger)i {
+    // Last process starting at or before i
+    NSUInteger lo = 0;
+    NSUInteger hi = _processCount;
+    while (hi - lo > 1) {
+        NSUInteger mid = lo + (hi - lo) / 2;
+        NSUInteger start = _unfiltered ? _snapshot.processes[mid].firstFile : fileStarts[mid];
+        if (start <= i) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+- (NSMutableArray<Item *> *)items {
+    NSMutableArray<Item *> *items = [NSMutableArray arrayWithCapacity:_processCount];
+    for (NSUInteger i = 0; i < _processCount; i++) {
+        [items addObject:[Item itemForProcessAtIndex:i ofResult:self]];
+    }
+    return items;
+}
+
+@end
@@ -1,5 +1,5 @@
 /*
-    Copyright (c) 2004-2025, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
     All rights reserved.
 
     Redistribution and use in source and binary forms, with or without modification,
@@ -30,11 +30,14 @@
 
 @import Foundation;
 
+#import "SnapshotBackend.h"
+
 NS_ASSUME_NONNULL_BEGIN
 
-@interface FSUtils : NSObject
+// Replays saved lsof field output (lsof -F fpPcntuaTdDiR +c0) from a file
+@interface FixtureTask : NSObject <SnapshotBackend>
 
-+ (NSDictionary<NSNumber*, NSDictionary*> *)mountedFileSystems;
+- (instancetype)initWithPath:(NSString *)path;
 
 @end
 
@@ -1,5 +1,5 @@
 /*
-    Copyright (c) 2003-2025, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
     All rights reserved.
 
     Redistribution and use in source and binary forms, with or without modification,
@@ -28,63 +28,28 @@
     POSSIBILITY OF SUCH DAMAGE.
 */
 
-#import "MutableDictProxy.h"
+#import "FixtureTask.h"
 
-@implementation MutableDictProxy
+#import "LsofTask.h"
 
-#pragma mark - NSMutableDictionary proxy
-
-- (instancetype)init {
-    if (self = [super init]) {
-        // Proxy dictionary object
-        properties = [[NSMutableDictionary alloc] init];
-    }
-    return self;
-}
-
-- (instancetype)initWithContentsOfFile:(NSString *)path {
-    if (self = [super init]) {
-        properties = [[NSMutableDictionary alloc] initWithContentsOfFile:path];
-    }
-    return self;
+@interface FixtureTask ()
+{
+    NSString *fixturePath;
 }
+@end
 
-- (instancetype)initWithCoder:(NSCoder *)aDecoder{
-    if (self = [super init]) {
-        properties = [[NSMutableDictionary alloc] initWithCoder:aDecoder];
-    }
-    return self;
-}
+@implementation FixtureTask
 
-- (instancetype)initWithDictionary:(NSDictionary *)dict {
-    if (self = [super init]) {
-        properties = [[NSMutableDictionary alloc] initWithDictionary:dict];
+- (instancetype)initWithPath:(NSString *)path {
+    self = [super init];
+    if (self) {
+        fixturePath = [path stringByExpandingTildeInPath];
     }
     return self;
 }
 
-- (void)removeObjectForKey:(id)aKey {
-    [properties removeObjectForKey:aKey];
-}
-
-- (void)setObject:(id)anObject forKey:(id <NSCopying>)aKey {
-    [properties setObject:anObject forKey:aKey];
-}
-
-- (id)objectForKey:(id)aKey {
-    return [properties objectForKey:aKey];
-}
-
-- (void)addEntriesFromDictionary:(NSDictionary *)otherDictionary {
-    [properties addEntriesFromDictionary:otherDictionary];
-}
-
-- (NSEnumerator *)keyEnumerator {
-    return [properties keyEnumerator];
-}
-
-- (NSUInteger)count {
-    return [properties count];
+- (Snapshot *)launch:(AuthorizationRef __nullable)authRef {
+    return [[LsofTask new] launchWithOutputFromFile:fixturePath];
 }
 
 @end
@@ -37,6 +37,8 @@ NS_ASSUME_NONNULL_BEGIN
 @interface InfoPanelController : NSWindowController <NSWindowDelegate>
 
 - (void)loadItem:(Item *)item;
+// Show the current values of the loaded item, if the panel is visible
+- (void)reloadItem;
 
 @end
 
@@ -68,7 +68,7 @@
 @property (weak) IBOutlet NSButton *showPackageContentsButton;
 
 @property (copy, nonatomic) NSString *path;
-@property (strong, nonatomic) NSDictionary *fileInfoDict;
+@property (strong, nonatomic) Item *fileInfoDict;
 
 @end
 
@@ -371,7 +371,7 @@
     return sizeString;
 }
 
-- (NSString *)accessModeDescriptionForItem:(NSDictionary *)itemDict {
+- (NSString *)accessModeDescriptionForItem:(Item *)itemDict {
     NSDictionary *descStrMap = @{ @"r": @"Read", @"w": @"Write", @"u": @"Read / Write" };
     
     // Parse file descriptor num
@@ -525,6 +525,12 @@
     return [NSString stringWithFormat:@"%@ (%@)", volName, [type uppercaseString]];
 }
 
+- (void)reloadItem {
+    if (self.fileInfoDict && [self.window isVisible]) {
+        [self loadItem:self.fileInfoDict];
+    }
+}
+
 #pragma mark - Interface actions
 
 - (IBAction)getInfoInFinder:(id)sender {
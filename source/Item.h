@@ -30,13 +30,49 @@
 
 @import Cocoa;
 
-#import "MutableDictProxy.h"
+#import "Snapshot.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
-// This class behaves like a dict since it inherits from MutableDictProxy object and
-// can therefore be subscripted using modern Objective-C syntax, e.g. spec[@"key"]
-@interface Item : MutableDictProxy
+@class FilterResult;
+
+// An item is a thin adapter over a process or file record in a snapshot.
+// It supports keyed access (e.g. item[@"name"]) and KVC so that it can be
+// used with bindings and sort descriptors, but it stores no values itself.
+@interface Item : NSObject
+
+@property (readonly, strong) Snapshot *snapshot;
+@property (readonly) NSUInteger index;
+@property (readonly) BOOL isProcess;
+@property (nonatomic, strong) NSMutableArray<Item *> *children; // Processes only
+@property (readonly) NSUInteger numChildren;
+
++ (NSMutableArray<Item *> *)itemsForSnapshot:(Snapshot *)snapshot;
++ (instancetype)itemForProcess:(NSUInteger)index inSnapshot:(Snapshot *)snapshot;
++ (instancetype)itemForFile:(NSUInteger)index inSnapshot:(Snapshot *)snapshot;
+
+// A view of a process in a filter result. Its children are only
+// created when first accessed, until then it holds only an index.
++ (instancetype)itemForProcessAtIndex:(NSUInteger)i ofResult:(FilterResult *)result;
+
+- (ProcessRecord *)process;
+- (FileRecord *)file;
+
+// Point item at the same process or file in a newer snapshot. If it has
+// changed, observers of its displayed values are notified.
+- (void)rebindToSnapshot:(Snapshot *)snapshot index:(NSUInteger)index changed:(BOOL)changed;
+
+// Take over the children of another item for the same process, without
+// creating them if they are still pending
+- (void)adoptChildrenOfItem:(Item *)item;
+
+// KVO-compliant mutation of children
+- (void)insertChildren:(NSArray<Item *> *)items atIndexes:(NSIndexSet *)indexes;
+- (void)removeChildrenAtIndexes:(NSIndexSet *)indexes;
+
+- (id __nullable)objectForKey:(NSString *)key;
+- (id __nullable)objectForKeyedSubscript:(NSString *)key;
+- (void)setObject:(id __nullable)obj forKeyedSubscript:(NSString *)key;
 
 @end
 
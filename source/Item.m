@@ -30,50 +30,389 @@
 
 #import "Item.h"
 
-#import "ProcessUtils.h"
+#import "FilterResult.h"
+#import "IconUtils.h"
+#import "EndpointGraph.h"
+#import "MountTable.h"
+
+typedef NS_ENUM(NSUInteger, ItemKey) {
+    ItemKeyUnknown = 0,
+    ItemKeyType,
+    ItemKeyName,
+    ItemKeyDisplayName,
+    ItemKeyImage,
+    ItemKeyPID,
+    ItemKeyPName,
+    ItemKeyChildren,
+    ItemKeyNumChildren,
+    // Process keys
+    ItemKeyUserID,
+    ItemKeyParentID,
+    ItemKeyBundle,
+    ItemKeyApp,
+    ItemKeyPath,
+    ItemKeyIdentifier,
+    ItemKeyPSN,
+    // File keys
+    ItemKeyFD,
+    ItemKeyAccessMode,
+    ItemKeyProcessUserID,
+    ItemKeyProcessImage,
+    ItemKeyIPVersion,
+    ItemKeyProtocol,
+    ItemKeySocketState,
+    ItemKeyDevCharCode,
+    ItemKeyDevice,
+    ItemKeyInode,
+    ItemKeyEndpoints
+};
+
+static NSDictionary<NSString*, NSNumber*> *itemKeys;
 
 @interface Item ()
 {
-    NSDictionary *lazyAttrs;
+    // Values set on the item that override those derived from the record
+    NSMutableDictionary *overrides;
+    
+    // Filter result the children are taken from, until they are created
+    FilterResult *result;
+    NSUInteger resultIndex;
 }
 @end
 
 @implementation Item
 
-- (instancetype)init {
+@synthesize children = _children;
+
++ (void)initialize {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        itemKeys = @{
+            @"type": @(ItemKeyType),
+            @"name": @(ItemKeyName),
+            @"displayname": @(ItemKeyDisplayName),
+            @"image": @(ItemKeyImage),
+            @"pid": @(ItemKeyPID),
+            @"pname": @(ItemKeyPName),
+            @"children": @(ItemKeyChildren),
+            @"numchildren": @(ItemKeyNumChildren),
+            @"userid": @(ItemKeyUserID),
+            @"parentid": @(ItemKeyParentID),
+            @"bundle": @(ItemKeyBundle),
+            @"app": @(ItemKeyApp),
+            @"path": @(ItemKeyPath),
+            @"identifier": @(ItemKeyIdentifier),
+            @"psn": @(ItemKeyPSN),
+            @"fd": @(ItemKeyFD),
+            @"accessmode": @(ItemKeyAccessMode),
+            @"puserid": @(ItemKeyProcessUserID),
+            @"pimage": @(ItemKeyProcessImage),
+            @"ipversion": @(ItemKeyIPVersion),
+            @"protocol": @(ItemKeyProtocol),
+            @"socketstate": @(ItemKeySocketState),
+            @"devcharcode": @(ItemKeyDevCharCode),
+            @"device": @(ItemKeyDevice),
+            @"inode": @(ItemKeyInode),
+            @"endpoints": @(ItemKeyEndpoints)
+        };
+    });
+}
+
++ (NSMutableArray<Item *> *)itemsForSnapshot:(Snapshot *)snapshot {
+    return [[FilterResult unfilteredResultForSnapshot:snapshot] items];
+}
+
++ (instancetype)itemForProcess:(NSUInteger)index inSnapshot:(Snapshot *)snapshot {
+    return [[self alloc] initWithSnapshot:snapshot index:index isProcess:YES];
+}
+
++ (instancetype)itemForFile:(NSUInteger)index inSnapshot:(Snapshot *)snapshot {
+    return [[self alloc] initWithSnapshot:snapshot index:index isProcess:NO];
+}
+
++ (instancetype)itemForProcessAtIndex:(NSUInteger)i ofResult:(FilterResult *)result {
+    Item *item = [[self alloc] initWithSnapshot:result.snapshot index:[result processAtIndex:i] isProcess:YES];
+    item->result = result;
+    item->resultIndex = i;
+    return item;
+}
+
+- (instancetype)initWithSnapshot:(Snapshot *)snapshot index:(NSUInteger)index isProcess:(BOOL)isProcess {
     self = [super init];
     if (self) {
-        // Getting som item properties is expensive and therefore lazy-loaded
-        lazyAttrs = @{
-            //@"identifier": [NSValue valueWithPointer:@selector(bundleIdentifier)]
-        };
+        _snapshot = snapshot;
+        _index = index;
+        _isProcess = isProcess;
     }
     return self;
 }
 
-- (id)objectForKey:(id)aKey {
-    // See if dict has an entry for this key
-    id obj = [properties objectForKey:aKey];
-    if (!obj) {
-        // If not, check if it's a lazy-load property
-        id val = [lazyAttrs objectForKey:aKey];
-        // If it is, generate the value using the appropriate selector
-        if (val) {
-            SEL sel = [val pointerValue];
-            if (sel && [self respondsToSelector:sel]) {
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Warc-performSelector-leaks"
-                properties[aKey] = [self performSelector:sel];
-#pragma clang diagnostic pop
-                return properties[aKey];
+- (ProcessRecord *)process {
+    if (_isProcess) {
+        return &[_snapshot processes][_index];
+    }
+    return &[_snapshot processes][[_snapshot files][_index].process];
+}
+
+- (FileRecord *)file {
+    NSAssert(!_isProcess, @"Process item has no file record");
+    return &[_snapshot files][_index];
+}
+
+#pragma mark - Children
+
+- (NSMutableArray<Item *> *)children {
+    if (_children == nil && result) {
+        NSRange range = [result fileRangeOfProcessAtIndex:resultIndex];
+        _children = [NSMutableArray arrayWithCapacity:range.length];
+        for (NSUInteger j = range.location; j < NSMaxRange(range); j++) {
+            [_children addObject:[Item itemForFile:[result fileAtIndex:j] inSnapshot:_snapshot]];
+        }
+        result = nil;
+    }
+    return _children;
+}
+
+- (void)setChildren:(NSMutableArray<Item *> *)children {
+    _children = children;
+    result = nil;
+}
+
+- (NSUInteger)numChildren {
+    if (_children == nil && result) {
+        return [result fileRangeOfProcessAtIndex:resultIndex].length;
+    }
+    return [_children count];
+}
+
+#pragma mark - Updating
+
+- (void)rebindToSnapshot:(Snapshot *)snapshot index:(NSUInteger)index changed:(BOOL)changed {
+    // Children from a result refer to the old snapshot
+    if (result && result.snapshot != snapshot) {
+        [self children];
+    }
+    
+    if (!changed) {
+        _snapshot = snapshot;
+        _index = index;
+        return;
+    }
+    
+    NSArray<NSString *> *keys = @[@"displayname", @"name", @"image", @"socketstate", @"accessmode"];
+    for (NSString *key in keys) {
+        [self willChangeValueForKey:key];
+    }
+    _snapshot = snapshot;
+    _index = index;
+    overrides = nil;
+    for (NSString *key in [keys reverseObjectEnumerator]) {
+        [self didChangeValueForKey:key];
+    }
+}
+
+- (void)adoptChildrenOfItem:(Item *)item {
+    [self willChangeValueForKey:@"displayname"];
+    _children = item->_children;
+    result = item->result;
+    resultIndex = item->resultIndex;
+    [self didChangeValueForKey:@"displayname"];
+}
+
+- (void)insertChildren:(NSArray<Item *> *)items atIndexes:(NSIndexSet *)indexes {
+    [self willChangeValueForKey:@"displayname"];
+    [[self children] insertObjects:items atIndexes:indexes];
+    [self didChangeValueForKey:@"displayname"];
+}
+
+- (void)removeChildrenAtIndexes:(NSIndexSet *)indexes {
+    [self willChangeValueForKey:@"displayname"];
+    [[self children] removeObjectsAtIndexes:indexes];
+    [self didChangeValueForKey:@"displayname"];
+}
+
+#pragma mark - Keyed access
+
+- (id __nullable)objectForKey:(NSString *)key {
+    id obj = overrides[key];
+    if (obj) {
+        return obj;
+    }
+    ItemKey k = [itemKeys[key] unsignedIntegerValue];
+    return _isProcess ? [self processValueForKey:k] : [self fileValueForKey:k];
+}
+
+- (id __nullable)objectForKeyedSubscript:(NSString *)key {
+    return [self objectForKey:key];
+}
+
+- (void)setObject:(id __nullable)obj forKeyedSubscript:(NSString *)key {
+    if (overrides == nil) {
+        overrides = [NSMutableDictionary new];
+    }
+    overrides[key] = obj;
+}
+
+// Bindings and sort descriptors use KVC
+- (id __nullable)valueForKey:(NSString *)key {
+    return [self objectForKey:key];
+}
+
+- (id __nullable)processValueForKey:(ItemKey)key {
+    ProcessRecord *p = [self process];
+    
+    switch (key) {
+        case ItemKeyType:
+            return @"Process";
+        case ItemKeyName:
+            return [_snapshot stringForRef:p->name];
+        case ItemKeyDisplayName:
+            // Show number of open files for process
+            return [NSString stringWithFormat:@"%@ (%lu)", [self processName], (unsigned long)[self numChildren]];
+        case ItemKeyImage:
+            return [_snapshot objectForRef:p->image];
+        case ItemKeyPID:
+            return [NSString stringWithFormat:@"%d", p->pid];
+        case ItemKeyPName:
+            return [self processName];
+        case ItemKeyChildren:
+            return [self children];
+        case ItemKeyNumChildren:
+            return @([self numChildren]);
+        case ItemKeyUserID:
+            return (p->uid == NO_UID) ? nil : @(p->uid);
+        case ItemKeyParentID:
+            return (p->ppid == -1) ? nil : @(p->ppid);
+        case ItemKeyBundle:
+            return @((p->flags & ProcessFlagBundle) != 0);
+        case ItemKeyApp:
+            return @((p->flags & ProcessFlagApp) != 0);
+        case ItemKeyPath:
+            return [_snapshot stringForRef:p->path];
+        case ItemKeyIdentifier:
+            return [_snapshot stringForRef:p->identifier];
+        case ItemKeyPSN:
+            return (p->psn == -1) ? nil : [NSString stringWithFormat:@"%d", p->psn];
+        default:
+            return nil;
+    }
+}
+
+- (id __nullable)fileValueForKey:(ItemKey)key {
+    FileRecord *f = [self file];
+    
+    switch (key) {
+        case ItemKeyType:
+            return NameForFileType(f->type);
+        case ItemKeyName:
+            return [_snapshot stringForRef:f->name];
+        case ItemKeyDisplayName:
+            return [self fileDisplayName];
+        case ItemKeyImage:
+            if (f->flags & FileFlagUnknownType) {
+                return [IconUtils imageNamed:@"QuestionMark"];
             }
+            return f->type ? [IconUtils imageNamed:NameForFileType(f->type)] : nil;
+        case ItemKeyPID:
+            return [NSString stringWithFormat:@"%d", [self process]->pid];
+        case ItemKeyPName:
+            return [self processName];
+        case ItemKeyFD:
+            return (f->fd == -1) ? [_snapshot stringForRef:f->fdName] : [NSString stringWithFormat:@"%d", f->fd];
+        case ItemKeyAccessMode:
+            return NameForAccessMode(f->accessMode);
+        case ItemKeyProcessUserID:
+        {
+            uid_t uid = [self process]->uid;
+            return (uid == NO_UID) ? nil : @(uid);
         }
+        case ItemKeyProcessImage:
+            return [_snapshot objectForRef:[self process]->image];
+        case ItemKeyIPVersion:
+            if (f->ipVersion == IPVersionNone) {
+                return nil;
+            }
+            return (f->ipVersion == IPVersion6) ? @"IPv6" : @"IPv4";
+        case ItemKeyProtocol:
+            return [_snapshot stringForRef:f->protocol];
+        case ItemKeySocketState:
+            return [_snapshot stringForRef:f->socketState];
+        case ItemKeyDevCharCode:
+            return f->devCharCode ? [NSString stringWithFormat:@"0x%llx", f->devCharCode] : nil;
+        case ItemKeyDevice:
+        {
+            if (!(f->flags & FileFlagHasDevice)) {
+                return nil;
+            }
+            NSDictionary *fs = [_snapshot.mountTable fileSystemForDevice:f->device];
+            return fs ? fs : @{ @"devid": @(f->device) };
+        }
+        case ItemKeyInode:
+            return (f->flags & FileFlagHasInode) ? @(f->inode) : nil;
+        case ItemKeyEndpoints:
+            return [self endpointDescriptions];
+        default:
+            return nil;
+    }
+}
+
+#pragma mark - Derived values
+
+- (NSString * __nullable)processName {
+    ProcessRecord *p = [self process];
+    NSString *pname = [_snapshot stringForRef:p->pname];
+    return pname ? pname : [_snapshot stringForRef:p->name];
+}
+
+- (NSString *)fileDisplayName {
+    FileRecord *f = [self file];
+    NSString *name = [_snapshot stringForRef:f->name];
+    NSString *displayName = [name length] ? name : @"Unnamed";
+    
+    NSString *socketState = [_snapshot stringForRef:f->socketState];
+    if (socketState) {
+        displayName = [NSString stringWithFormat:@"%@ (%@)", name, socketState];
+    }
+    
+    // Show which process owns the other end of the pipe/socket
+    const uint32_t *endpoints;
+    NSUInteger count = [_snapshot.endpointGraph endpointsForFile:_index indices:&endpoints];
+    if (count) {
+        Item *first = [Item itemForFile:endpoints[0] inSnapshot:_snapshot];
+        displayName = [NSString stringWithFormat:@"%@ (%@%@)",
+                       displayName, [first processName],
+                       count > 1 ? @" ..." : @""];
     }
-    return obj;
+    
+    return displayName;
 }
 
-- (NSString * __nullable)bundleIdentifier {
-    return [ProcessUtils identifierForBundleAtPath:self[@"path"]];
+- (NSArray<NSString *> * __nullable)endpointDescriptions {
+    const uint32_t *endpoints;
+    NSUInteger count = [_snapshot.endpointGraph endpointsForFile:_index indices:&endpoints];
+    if (count == 0) {
+        return nil;
+    }
+    NSMutableArray<NSString *> *descriptions = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        Item *endpoint = [Item itemForFile:endpoints[i] inSnapshot:_snapshot];
+        [descriptions addObject:[NSString stringWithFormat:@"%@ (%d)", [endpoint processName], [endpoint process]->pid]];
+    }
+    return descriptions;
+}
+
+- (NSString *)description {
+    NSMutableDictionary *dict = [NSMutableDictionary new];
+    for (NSString *key in itemKeys) {
+        if ([key isEqualToString:@"children"]) {
+            continue;
+        }
+        id value = [self objectForKey:key];
+        if (value) {
+            dict[key] = value;
+        }
+    }
+    return [dict description];
 }
 
 @end
@@ -0,0 +1,422 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "LsofParser.h"
+
+#import "Common.h"
+
+#ifdef DEBUG
+#import <malloc/malloc.h>
+#endif
+
+@interface LsofParser ()
+{
+    Snapshot *snapshot;
+    
+    NSInteger currentProcess;
+    NSInteger currentFile;
+    BOOL skip;
+    
+    BOOL showProcessBinaries;
+    BOOL showCurrentWorkingDirectories;
+    
+    // Holds the trailing part of a line split across chunks
+    NSMutableData *partialLine;
+    
+#ifdef DEBUG
+    NSUInteger bytesParsed;
+    NSUInteger linesParsed;
+    CFAbsoluteTime parseTime;
+    // Net heap blocks allocated while parsing
+    long long blocksAllocated;
+#endif
+}
+@end
+
+@implementation LsofParser
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        snapshot = [Snapshot new];
+        currentProcess = -1;
+        currentFile = -1;
+        showProcessBinaries = [DEFAULTS boolForKey:@"showProcessBinaries"];
+        showCurrentWorkingDirectories = [DEFAULTS boolForKey:@"showCurrentWorkingDirectories"];
+        partialLine = [NSMutableData data];
+    }
+    return self;
+}
+
+#pragma mark - Chunked input
+
+- (void)parseBytes:(const char *)bytes length:(NSUInteger)length {
+#ifdef DEBUG
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    malloc_statistics_t startStats;
+    malloc_zone_statistics(NULL, &startStats);
+#endif
+    const char *end = bytes + length;
+    const char *start = bytes;
+    
+    while (start < end) {
+        const char *newline = memchr(start, '\n', end - start);
+        if (newline == NULL) {
+            // Incomplete line, wait for the rest of it
+            [partialLine appendBytes:start length:end - start];
+            break;
+        }
+        
+        if ([partialLine length]) {
+            // Complete the line carried over from the previous chunk
+            [partialLine appendBytes:start length:newline - start];
+            [self parseLine:[partialLine bytes] length:[partialLine length]];
+            [partialLine setLength:0];
+        } else {
+            [self parseLine:start length:newline - start];
+        }
+        
+        start = newline + 1;
+    }
+    
+#ifdef DEBUG
+    malloc_statistics_t endStats;
+    malloc_zone_statistics(NULL, &endStats);
+    blocksAllocated += (long long)endStats.blocks_in_use - (long long)startStats.blocks_in_use;
+    bytesParsed += length;
+    parseTime += CFAbsoluteTimeGetCurrent() - startTime;
+#endif
+}
+
+#pragma mark - Parse
+
+// Field values are compared and decoded in place, straight from the raw
+// output bytes. String values are interned in the snapshot's string pool.
+
+#define VALUE_IS(S) (valueLength == sizeof(S) - 1 && memcmp(value, S, sizeof(S) - 1) == 0)
+#define VALUE_HAS_PREFIX(S) (valueLength >= sizeof(S) - 1 && memcmp(value, S, sizeof(S) - 1) == 0)
+#define VALUE_HAS_SUFFIX(S) (valueLength >= sizeof(S) - 1 && memcmp(value + valueLength - (sizeof(S) - 1), S, sizeof(S) - 1) == 0)
+
+static inline long long DecimalFromBytes(const char *bytes, NSUInteger length) {
+    long long num = 0;
+    for (NSUInteger i = 0; i < length && bytes[i] >= '0' && bytes[i] <= '9'; i++) {
+        num = (num * 10) + (bytes[i] - '0');
+    }
+    return num;
+}
+
+static inline unsigned long long HexFromBytes(const char *bytes, NSUInteger length) {
+    if (length > 1 && bytes[0] == '0' && (bytes[1] == 'x' || bytes[1] == 'X')) {
+        bytes += 2;
+        length -= 2;
+    }
+    unsigned long long num = 0;
+    for (NSUInteger i = 0; i < length; i++) {
+        char c = bytes[i];
+        if (c >= '0' && c <= '9') {
+            num = (num << 4) | (c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            num = (num << 4) | (c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            num = (num << 4) | (c - 'A' + 10);
+        } else {
+            break;
+        }
+    }
+    return num;
+}
+
+// Map lsof file type (e.g. "VREG") to the type we display.
+// Returns FileTypeUnknown for file types we don't show.
+static inline FileType FileTypeFromBytes(const char *value, NSUInteger valueLength) {
+    switch (value[0]) {
+        case 'V':
+            if (VALUE_IS("VREG")) { return FileTypeFile; }
+            if (VALUE_IS("VDIR")) { return FileTypeDirectory; }
+            if (VALUE_IS("VCHR")) { return FileTypeCharDevice; }
+            break;
+        case 'R':
+            if (VALUE_IS("REG")) { return FileTypeFile; }
+            break;
+        case 'D':
+            if (VALUE_IS("DIR")) { return FileTypeDirectory; }
+            break;
+        case 'C':
+            if (VALUE_IS("CHR")) { return FileTypeCharDevice; }
+            break;
+        case 'I':
+            if (VALUE_IS("IPv4") || VALUE_IS("IPv6")) { return FileTypeIPSocket; }
+            break;
+        case 'u':
+            if (VALUE_IS("unix")) { return FileTypeUnixSocket; }
+            break;
+        case 'P':
+            if (VALUE_IS("PIPE")) { return FileTypePipe; }
+            break;
+    }
+    return FileTypeUnknown;
+}
+
+- (void)parseLine:(const char *)bytes length:(NSUInteger)length {
+    // Parse-friendly lsof output has the following format:
+    //
+    //    p113                              // PROCESS INFO STARTS (pid)
+    //    cloginwindow                          // name
+    //    u501                                  // uid
+    //    fcwd                              // FILE INFO STARTS (file descriptor)
+    //    a                                     // access mode
+    //    tDIR                                  // type
+    //    n/path/to/directory                   // name / path
+    //    f0                                // FILE INFO STARTS (file descriptor)
+    //    au                                    // access mode
+    //    tCHR                                  // type
+    //    n/dev/null                            // name / path
+    //    etc...
+    //
+    // We parse this into a snapshot with a record for each process,
+    // followed by records for each of the process's files.
+    
+    if (length == 0) {
+        return;
+    }
+#ifdef DEBUG
+    linesParsed += 1;
+#endif
+    
+    char prefix = bytes[0];
+    const char *value = bytes + 1;
+    NSUInteger valueLength = length - 1;
+    
+    // Nothing to do for file fields if the file is being skipped
+    BOOL isProcessField = (prefix == 'p' || prefix == 'c' || prefix == 'u' || prefix == 'R' || prefix == 'f');
+    if (!isProcessField && (currentFile == -1 || skip)) {
+        return;
+    }
+    if (prefix != 'p' && currentProcess == -1) {
+        return;
+    }
+    
+    ProcessRecord *p = (currentProcess != -1) ? &snapshot.processes[currentProcess] : NULL;
+    FileRecord *f = (currentFile != -1 && !skip) ? &snapshot.files[currentFile] : NULL;
+    
+    switch (prefix) {
+        
+        // PID - First line of output for new process
+        case 'p':
+        {
+            currentProcess = [snapshot addProcess];
+            currentFile = -1;
+            skip = NO;
+            snapshot.processes[currentProcess].pid = (pid_t)DecimalFromBytes(value, valueLength);
+        }
+            break;
+            
+        // Process name
+        case 'c':
+            p->name = [snapshot addStringWithBytes:value length:valueLength];
+            break;
+            
+        // Process UID
+        case 'u':
+            p->uid = (uid_t)DecimalFromBytes(value, valueLength);
+            break;
+        
+        // Parent process ID
+        case 'R':
+            p->ppid = (pid_t)DecimalFromBytes(value, valueLength);
+            break;
+        
+        // File descriptor - First line of output for a file
+        case 'f':
+        {
+            currentFile = -1;
+            skip = NO;
+            
+            // Numeric file descriptors are by far the most common
+            BOOL isNumeric = (valueLength && value[0] >= '0' && value[0] <= '9');
+            BOOL isError = NO;
+            if (!isNumeric) {
+                // txt files are program code, such as the application binary itself or a shared library
+                if (VALUE_IS("txt")) {
+                    skip = !showProcessBinaries;
+                }
+                // cwd and twd are current working directory and thread working directory, respectively
+                else if (VALUE_IS("cwd") || VALUE_IS("twd")) {
+                    skip = !showCurrentWorkingDirectories;
+                }
+                else if (VALUE_IS("err")) {
+                    isError = YES;
+                }
+            }
+            if (skip) {
+                break;
+            }
+            
+            // New file info starting, add file record
+            currentFile = [snapshot addFileToProcess:currentProcess];
+            f = &snapshot.files[currentFile];
+            if (isNumeric) {
+                f->fd = (int32_t)DecimalFromBytes(value, valueLength);
+            } else {
+                f->fdName = [snapshot addStringWithBytes:value length:valueLength];
+            }
+            if (isError) {
+                f->type = FileTypeError;
+            }
+        }
+            break;
+        
+        // File access mode
+        case 'a':
+        {
+            // Access mode is a single character, r, w or u
+            switch (valueLength ? value[0] : 0) {
+                case 'r': f->accessMode = AccessModeRead; break;
+                case 'w': f->accessMode = AccessModeWrite; break;
+                case 'u': f->accessMode = AccessModeReadWrite; break;
+                default:  f->accessMode = AccessModeNone; break;
+            }
+        }
+            break;
+            
+        // File type
+        case 't':
+        {
+            FileType type = valueLength ? FileTypeFromBytes(value, valueLength) : FileTypeUnknown;
+            if (type == FileTypeUnknown) {
+                //DLog(@"Unrecognized file type: %.*s", (int)valueLength, value);
+                [self skipCurrentFile];
+                break;
+            }
+            
+            f->type = type;
+            if (type == FileTypeIPSocket) {
+                f->ipVersion = (value[3] == '6') ? IPVersion6 : IPVersion4;
+            }
+        }
+            break;
+        
+        // File name / path
+        case 'n':
+        {
+            // Some files when running in root mode have no type listed
+            // and are only reported with the name "(revoked)". Skip those.
+            if (f->type == FileTypeUnknown && VALUE_IS("(revoked)")) {
+                [self skipCurrentFile];
+                break;
+            }
+            
+            f->name = [snapshot addStringWithBytes:value length:valueLength];
+            
+            if (VALUE_HAS_SUFFIX("Operation not permitted")) {
+                f->type = FileTypeError;
+            }
+            
+            if (VALUE_HAS_PREFIX("unknown file type:")) {
+                f->flags |= FileFlagUnknownType;
+            }
+            
+            // Identifiable pipes and sockets have names in the format "->0x<device character code>"
+            if ((f->type == FileTypeUnixSocket || f->type == FileTypePipe) && VALUE_HAS_PREFIX("->0x")) {
+                f->peerCharCode = HexFromBytes(value + 2, valueLength - 2);
+            }
+        }
+            break;
+        
+        // Protocol (IP sockets only)
+        case 'P':
+            f->protocol = [snapshot addStringWithBytes:value length:valueLength];
+            break;
+            
+        // TCP socket info (IP sockets only)
+        case 'T':
+        {
+            if (VALUE_HAS_PREFIX("ST=")) {
+                f->socketState = [snapshot addStringWithBytes:value + 3 length:valueLength - 3];
+            }
+        }
+            break;
+            
+        // Device character code
+        case 'd':
+            f->devCharCode = HexFromBytes(value, valueLength);
+            break;
+            
+        // File's major/minor device number (0x<hexadecimal>)
+        case 'D':
+            f->device = (dev_t)HexFromBytes(value, valueLength);
+            f->flags |= FileFlagHasDevice;
+            break;
+        
+        // File inode number
+        case 'i':
+            f->inode = (uint64_t)DecimalFromBytes(value, valueLength);
+            f->flags |= FileFlagHasInode;
+            break;
+    }
+}
+
+// Discard the file currently being parsed. It is always the last one added.
+- (void)skipCurrentFile {
+    [snapshot removeLastFile];
+    currentFile = -1;
+    skip = YES;
+}
+
+- (Snapshot *)finish {
+    // Output may not have ended with a newline
+    if ([partialLine length]) {
+        [self parseLine:[partialLine bytes] length:[partialLine length]];
+        [partialLine setLength:0];
+    }
+    
+    if ([snapshot processCount] == 0) {
+        DLog(@"Empty lsof output!");
+        return snapshot;
+    }
+    
+#ifdef DEBUG
+    // Heap statistics cover all threads, so block counts are approximate.
+    // The line-based parser this replaced created at least two NSString
+    // objects for every line, which serves as the baseline.
+    double mb = bytesParsed / (1024.0 * 1024.0);
+    NSUInteger numRecords = [snapshot processCount] + [snapshot fileCount];
+    DLog(@"Parsed %.1f MB of lsof output in %.3f sec (%.1f MB/s)", mb, parseTime, parseTime > 0 ? mb / parseTime : 0);
+    DLog(@"%lu records, %.2f heap blocks per record (line-based parser baseline: >= %.2f objects per record)",
+         (unsigned long)numRecords, (double)blocksAllocated / numRecords, 2.0 * linesParsed / numRecords);
+#endif
+    
+    currentProcess = -1;
+    currentFile = -1;
+    
+    return snapshot;
+}
+
+@end
@@ -0,0 +1,69 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_OPTIONS(NSUInteger, LsofSocketSelection) {
+    LsofSelectIPSockets     = 1 << 0,
+    LsofSelectUnixSockets   = 1 << 1
+};
+
+// Restricts what lsof lists, based on the active filters. Filters that
+// can't be expressed as lsof selectors fall back on listing everything,
+// and all filters are still applied to the output. The query only lets
+// lsof skip files that would be filtered out anyway.
+@interface LsofQuery : NSObject
+
+// 0 if not restricted by socket type
+@property (readonly) LsofSocketSelection sockets;
+// nil if not restricted to a single file system
+@property (readonly, copy, nullable) NSString *mountPoint;
+// nil if not restricted to some processes
+@property (readonly, copy, nullable) NSIndexSet *pids;
+@property (readonly) BOOL isFullScan;
+
++ (instancetype)fullScan;
++ (instancetype)queryForFiltersWithMountPoint:(NSString * __nullable)mountPoint;
+
+// Same selection, but only for the processes with the given PIDs
+- (instancetype)queryRestrictedToPIDs:(NSIndexSet *)pids;
+
+// Selection arguments. These must come last, since
+// file system names follow the end of options.
+- (NSArray<NSString *> *)arguments;
+
+// Whether output for this query contains all files the other would select
+- (BOOL)covers:(LsofQuery *)query;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,164 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "LsofQuery.h"
+
+#import "Common.h"
+
+@implementation LsofQuery
+
+- (instancetype)initWithSockets:(LsofSocketSelection)sockets
+                     mountPoint:(NSString * __nullable)mountPoint
+                           pids:(NSIndexSet * __nullable)pids {
+    self = [super init];
+    if (self) {
+        _sockets = sockets;
+        _mountPoint = [mountPoint copy];
+        _pids = [pids copy];
+    }
+    return self;
+}
+
+- (instancetype)initWithSockets:(LsofSocketSelection)sockets mountPoint:(NSString * __nullable)mountPoint {
+    return [self initWithSockets:sockets mountPoint:mountPoint pids:nil];
+}
+
++ (instancetype)fullScan {
+    return [[LsofQuery alloc] initWithSockets:0 mountPoint:nil];
+}
+
++ (instancetype)queryForFiltersWithMountPoint:(NSString * __nullable)mountPoint {
+    if ([DEFAULTS boolForKey:@"filterPushdown"] == NO) {
+        return [LsofQuery fullScan];
+    }
+    
+    // Home folder paths can span file systems, and lsof's +D
+    // scans the whole directory tree, so list everything
+    if ([DEFAULTS boolForKey:@"showHomeFolderOnly"]) {
+        return [LsofQuery fullScan];
+    }
+    
+    // The volume filter only shows files and directories, which
+    // lsof can select by the file system they're on
+    if ([mountPoint length]) {
+        return [[LsofQuery alloc] initWithSockets:0 mountPoint:mountPoint];
+    }
+    
+    // Sockets can be selected by type if nothing else is shown
+    BOOL showOtherTypes = ([DEFAULTS boolForKey:@"showRegularFiles"] ||
+                           [DEFAULTS boolForKey:@"showDirectories"] ||
+                           [DEFAULTS boolForKey:@"showCharacterDevices"] ||
+                           [DEFAULTS boolForKey:@"showPipes"]);
+    LsofSocketSelection sockets = 0;
+    if (!showOtherTypes) {
+        if ([DEFAULTS boolForKey:@"showIPSockets"]) {
+            sockets |= LsofSelectIPSockets;
+        }
+        if ([DEFAULTS boolForKey:@"showUnixSockets"]) {
+            sockets |= LsofSelectUnixSockets;
+        }
+    }
+    return [[LsofQuery alloc] initWithSockets:sockets mountPoint:nil];
+}
+
+- (instancetype)queryRestrictedToPIDs:(NSIndexSet *)pids {
+    return [[LsofQuery alloc] initWithSockets:_sockets mountPoint:_mountPoint pids:pids];
+}
+
+- (BOOL)isFullScan {
+    return (_sockets == 0 && _mountPoint == nil && _pids == nil);
+}
+
+- (NSArray<NSString *> *)arguments {
+    NSMutableArray *args = [NSMutableArray new];
+    
+    // lsof ORs selectors unless -a is given, in which case all of them
+    // are ANDed. Selecting both socket types therefore can't be combined
+    // with other selectors, so the socket selection is dropped then.
+    LsofSocketSelection sockets = _sockets;
+    if (sockets == (LsofSelectIPSockets | LsofSelectUnixSockets) && (_mountPoint || _pids)) {
+        sockets = 0;
+    }
+    NSUInteger numSelectors = (sockets ? 1 : 0) + (_mountPoint ? 1 : 0) + (_pids ? 1 : 0);
+    if (numSelectors > 1) {
+        [args addObject:@"-a"];
+    }
+    if (_pids) {
+        NSMutableArray<NSString *> *pidStrings = [NSMutableArray arrayWithCapacity:[_pids count]];
+        [_pids enumerateIndexesUsingBlock:^(NSUInteger pid, BOOL *stop) {
+            [pidStrings addObject:[NSString stringWithFormat:@"%lu", (unsigned long)pid]];
+        }];
+        [args addObjectsFromArray:@[@"-p", [pidStrings componentsJoinedByString:@","]]];
+    }
+    if (sockets & LsofSelectIPSockets) {
+        [args addObject:@"-i"];
+    }
+    if (sockets & LsofSelectUnixSockets) {
+        [args addObject:@"-U"];
+    }
+    if (_mountPoint) {
+        [args addObjectsFromArray:@[@"+f", @"--", _mountPoint]];
+    }
+    return args;
+}
+
+- (BOOL)covers:(LsofQuery *)query {
+    if (_pids && (query.pids == nil || ![_pids containsIndexes:query.pids])) {
+        return NO;
+    }
+    if (_sockets && (query.sockets == 0 || (query.sockets & ~_sockets))) {
+        return NO;
+    }
+    if (_mountPoint && ![_mountPoint isEqualToString:query.mountPoint]) {
+        return NO;
+    }
+    return YES;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[LsofQuery class]]) {
+        return NO;
+    }
+    LsofQuery *other = object;
+    return (_sockets == other.sockets &&
+            (_mountPoint == other.mountPoint || [_mountPoint isEqualToString:other.mountPoint]) &&
+            (_pids == other.pids || [_pids isEqualToIndexSet:other.pids]));
+}
+
+- (NSUInteger)hash {
+    return _sockets ^ [_mountPoint hash] ^ [_pids count];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<LsofQuery: %@>",
+            self.isFullScan ? @"all" : [[self arguments] componentsJoinedByString:@" "]];
+}
+
+@end
@@ -29,17 +29,31 @@
 */
 
 @import Foundation;
+@import Security;
 
-#import "Item.h"
+#import "SnapshotBackend.h"
+#import "LsofQuery.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
-@class Item;
+@interface LsofTask : NSObject <SnapshotBackend>
 
-@interface LsofTask : NSObject
+// What lsof should list. Defaults to everything.
+@property (strong) LsofQuery *query;
 
-- (NSMutableArray<Item *> *)launch:(AuthorizationRef __nullable)authRef numFiles:(NSInteger *)numFiles;
-+ (void)updateProcessInfo:(NSMutableDictionary *)p;
+- (Snapshot * __nullable)launch:(AuthorizationRef __nullable)authRef;
+- (Snapshot *)launchWithOutputFromFile:(NSString *)path;
+
+// Keep a single lsof running in repeat mode, calling handler on a background
+// thread with a new snapshot after each iteration until the task is stopped
+- (void)startRepeating:(AuthorizationRef __nullable)authRef
+              interval:(NSInteger)seconds
+               handler:(void (^)(Snapshot *snapshot))handler;
+- (void)stop;
+
++ (Snapshot *)completeSnapshot:(Snapshot *)snapshot;
++ (Snapshot *)completeSnapshot:(Snapshot *)snapshot partial:(BOOL)partial;
++ (void)updateProcessInfo:(NSUInteger)index inSnapshot:(Snapshot *)snapshot friendlyNames:(BOOL)friendlyNames;
 
 @end
 
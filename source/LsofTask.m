@@ -32,381 +32,370 @@
 
 #import "Common.h"
 #import "STPrivilegedTask.h"
-#import "Item.h"
-#import "FSUtils.h"
-#import "IconUtils.h"
+#import "LsofParser.h"
 #import "ProcessUtils.h"
+#import "ProcessTable.h"
+#import "MountTable.h"
+#import "ProcessInfoCache.h"
+
+@interface LsofTask ()
+{
+    NSTask *task;
+}
+@property (atomic) BOOL stopped;
+@end
 
 @implementation LsofTask
 
-- (NSMutableArray<Item *> *)launch:(AuthorizationRef __nullable)authRef numFiles:(NSInteger *)numFiles {
-    return [self parse:[self run:authRef] numFiles:numFiles];
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _query = [LsofQuery fullScan];
+    }
+    return self;
 }
 
-- (NSString *)run:(AuthorizationRef)authRef {
+- (Snapshot * __nullable)launch:(AuthorizationRef __nullable)authRef {
+    __block Snapshot *result = nil;
+    [self run:authRef repeatInterval:0 handler:^(Snapshot *snapshot) {
+        result = snapshot;
+    }];
+    return result;
+}
+
+- (Snapshot *)launchWithOutputFromFile:(NSString *)path {
+    __block Snapshot *result = nil;
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForReadingAtPath:path];
+    if (fileHandle == nil) {
+        DLog(@"Unable to read lsof output from %@", path);
+    }
+    [self read:fileHandle repeating:NO handler:^(Snapshot *snapshot) {
+        result = snapshot;
+    }];
+    [fileHandle closeFile];
+    return result;
+}
+
+- (void)startRepeating:(AuthorizationRef __nullable)authRef
+              interval:(NSInteger)seconds
+               handler:(void (^)(Snapshot *snapshot))handler {
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        @autoreleasepool {
+            [self run:authRef repeatInterval:seconds handler:handler];
+            DLog(@"lsof repeat session ended");
+        }
+    });
+}
+
+- (void)stop {
+    self.stopped = YES;
+    // Privileged tasks can't be terminated. They exit on SIGPIPE
+    // when writing the next iteration after we stop reading.
+    @synchronized(self) {
+        [task terminate];
+    }
+}
+
+- (void)run:(AuthorizationRef)authRef
+    repeatInterval:(NSInteger)seconds
+           handler:(void (^)(Snapshot *snapshot))handler {
     DLog(@"Running lsof task");
-    NSData *outputData;
+    
+    NSMutableArray *args = [self args];
+    if (seconds > 0) {
+        // Repeat mode, output a marker line between iterations
+        [args addObject:[NSString stringWithFormat:@"-r%ld", (long)seconds]];
+    }
+    [args addObjectsFromArray:[self.query arguments]];
+    DLog(@"lsof %@", [args componentsJoinedByString:@" "]);
+    
+    NSFileHandle *fileHandle;
+#ifdef DEBUG
+    CFAbsoluteTime spawnTime = CFAbsoluteTimeGetCurrent();
+#endif
     
     if (authRef) {
-        STPrivilegedTask *task = [[STPrivilegedTask alloc] init];
-        [task setLaunchPath:LSOF_PATH];
-        [task setArguments:[self args]];
-        [task launchWithAuthorization:authRef];
-        
-        outputData = [[task outputFileHandle] readDataToEndOfFile];
+        STPrivilegedTask *privilegedTask = [[STPrivilegedTask alloc] init];
+        [privilegedTask setLaunchPath:LSOF_PATH];
+        [privilegedTask setArguments:args];
+        [privilegedTask launchWithAuthorization:authRef];
         
+        fileHandle = [privilegedTask outputFileHandle];
     } else {
-        
         NSTask *lsof = [[NSTask alloc] init];
         [lsof setLaunchPath:LSOF_PATH];
-        [lsof setArguments:[self args]];
+        [lsof setArguments:args];
         
         NSPipe *pipe = [NSPipe pipe];
         [lsof setStandardOutput:pipe];
         [lsof setStandardError:[NSFileHandle fileHandleWithNullDevice]];
         [lsof setStandardInput:[NSFileHandle fileHandleWithNullDevice]];
-        [lsof launch];
+        @synchronized(self) {
+            if (self.stopped) {
+                return;
+            }
+            [lsof launch];
+            task = lsof;
+        }
         
-        outputData = [[pipe fileHandleForReading] readDataToEndOfFile];
+        fileHandle = [pipe fileHandleForReading];
     }
+#ifdef DEBUG
+    DLog(@"Spawned lsof in %.3f sec", CFAbsoluteTimeGetCurrent() - spawnTime);
+#endif
     
-    return [[NSString alloc] initWithData:outputData encoding:NSUTF8StringEncoding];
+    [self read:fileHandle repeating:(seconds > 0) handler:handler];
+    
+    // Closing our end of the pipe ends a repeating lsof on its next write
+    [fileHandle closeFile];
+    @synchronized(self) {
+        task = nil;
+    }
 }
 
-- (NSMutableArray<Item *> *)parse:(NSString *)outputString numFiles:(NSInteger *)numFiles {
-    // Parse-friendly lsof output has the following format:
-    //
-    //    p113                              // PROCESS INFO STARTS (pid)
-    //    cloginwindow                          // name
-    //    u501                                  // uid
-    //    fcwd                              // FILE INFO STARTS (file descriptor)
-    //    a                                     // access mode
-    //    tDIR                                  // type
-    //    n/path/to/directory                   // name / path
-    //    f0                                // FILE INFO STARTS (file descriptor)
-    //    au                                    // access mode
-    //    tCHR                                  // type
-    //    n/dev/null                            // name / path
-    //    etc...
-    //
-    // We parse this into an array of processes, each of which has children.
-    // Each child is a dictionary containing file/socket info.
+// Add info that isn't part of lsof output to a newly parsed snapshot
++ (Snapshot *)completeSnapshot:(Snapshot *)snapshot {
+    return [LsofTask completeSnapshot:snapshot partial:NO];
+}
+
+// Endpoints of a partial snapshot are resolved once it has been merged
+// into a full one
++ (Snapshot *)completeSnapshot:(Snapshot *)snapshot partial:(BOOL)partial {
+#ifdef DEBUG
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+#endif
+    snapshot.mountTable = [MountTable currentTable];
+    
+    // Map sockets and pipes to their endpoints
+    if (!partial) {
+        [snapshot resolveEndpoints];
+    }
+    
+    // Process lookups below use a single process table fetch
+    ProcessTable *table = [ProcessTable reloadCurrentTable];
+    
+    // Get additional info about the processes. This is cached
+    // across refreshes, so only new processes are looked up.
+    BOOL friendlyNames = [DEFAULTS boolForKey:@"friendlyProcessNames"];
+    for (NSUInteger i = 0; i < [snapshot processCount]; i++) {
+        [LsofTask updateProcessInfo:i inSnapshot:snapshot friendlyNames:friendlyNames];
+    }
     
-    DLog(@"Parsing lsof output");
-    NSMutableArray *processList = [NSMutableArray new];
-    *numFiles = 0;
+    // Drop cached info for processes that have exited. Restricted and
+    // partial listings leave out running processes, so the process
+    // table tells which are still running, not the snapshot.
+    if (table) {
+        NSMutableSet<NSNumber *> *pids = [NSMutableSet setWithCapacity:[table count]];
+        for (NSUInteger i = 0; i < [table count]; i++) {
+            [pids addObject:@(table.entries[i].pid)];
+        }
+        [[ProcessInfoCache sharedCache] evictProcessesNotInSet:pids];
+    }
+    
+#ifdef DEBUG
+    DLog(@"Added process and endpoint info in %.3f sec", CFAbsoluteTimeGetCurrent() - startTime);
+    [snapshot logStringStatistics];
+#endif
     
-    if (![outputString length]) {
-        DLog(@"Empty lsof output!");
-        return processList;
+    return snapshot;
+}
+
+// Find the end of the last complete process in buffer, i.e. the position
+// following the last newline that is followed by a "p" (PID) line.
+// Returns 0 if there is no such boundary.
+static NSUInteger LastProcessBoundary(const char *bytes, NSUInteger length) {
+    for (NSUInteger i = length - 1; i > 0; i--) {
+        if (bytes[i] == 'p' && bytes[i-1] == '\n') {
+            return i;
+        }
+    }
+    return 0;
+}
+
+// Look for an "m" marker line separating repeat mode iterations, checking
+// complete lines starting at *offset. If none is found, *offset is set to
+// the start of the first incomplete line, where the next search should start.
+static BOOL FindMarkerLine(const char *bytes, NSUInteger length, NSUInteger *offset,
+                           NSUInteger *markerStart, NSUInteger *markerEnd) {
+    NSUInteger lineStart = *offset;
+    while (lineStart < length) {
+        const char *newline = memchr(bytes + lineStart, '\n', length - lineStart);
+        if (newline == NULL) {
+            break;
+        }
+        NSUInteger lineEnd = newline - bytes + 1;
+        if (bytes[lineStart] == 'm') {
+            *markerStart = lineStart;
+            *markerEnd = lineEnd;
+            return YES;
+        }
+        lineStart = lineEnd;
+    }
+    *offset = lineStart;
+    return NO;
+}
+
+// Read output in fixed-size chunks as it arrives, so parsing overlaps with
+// the lsof run. Output for each process is independent of all others, so
+// output is cut into segments at process boundaries and the segments are
+// parsed concurrently. The resulting snapshots are merged in output order.
+// In repeat mode, each marker-delimited iteration becomes a new snapshot.
+- (void)read:(NSFileHandle * __nullable)fileHandle
+   repeating:(BOOL)repeating
+     handler:(void (^)(Snapshot *snapshot))handler {
+    __block NSMutableArray<LsofParser *> *parsers = [NSMutableArray arrayWithObject:[LsofParser new]];
+    if (fileHandle == nil) {
+        handler([LsofTask completeSnapshot:[parsers[0] finish] partial:(self.query.pids != nil)]);
+        return;
     }
     
-    // Get info about mounted filesystems
-    NSDictionary *fileSystems = [FSUtils mountedFileSystems];
+#ifdef DEBUG
+    __block CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+#endif
     
-    // Maps device character codes to items. Used to find socket/pipe endpoints.
-    NSMutableDictionary *devCharCodeMap = [NSMutableDictionary dictionary];
+    int fd = [fileHandle fileDescriptor];
+    NSUInteger numCPUs = [[NSProcessInfo processInfo] activeProcessorCount];
     
-    Item *currentProcess;
-    Item *currentFile;
-    BOOL skip = NO;
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0);
+    dispatch_group_t group = dispatch_group_create();
+    // Bound the number of segments held in memory awaiting parsing
+    dispatch_semaphore_t inFlight = dispatch_semaphore_create(numCPUs);
     
-    // Parse each line
-    for (NSString *line in [outputString componentsSeparatedByString:@"\n"]) {
-        if ([line length] == 0) {
-            continue;
+    void (^parseSegment)(LsofParser *, NSData *, NSUInteger) = ^(LsofParser *parser, NSData *data, NSUInteger length) {
+        dispatch_semaphore_wait(inFlight, DISPATCH_TIME_FOREVER);
+        dispatch_group_async(group, queue, ^{
+            [parser parseBytes:[data bytes] length:length];
+            dispatch_semaphore_signal(inFlight);
+        });
+    };
+    
+    // Merge segments into a single snapshot, preserving process order
+    Snapshot *(^finishIteration)(void) = ^Snapshot *{
+        dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+        Snapshot *snapshot = [parsers[0] finish];
+        for (NSUInteger i = 1; i < [parsers count]; i++) {
+            [snapshot appendSnapshot:[parsers[i] finish]];
         }
-        
-        unichar prefix = [line characterAtIndex:0];
-        NSString *value = [line substringFromIndex:1];
-        
-        switch (prefix) {
-            
-            // PID - First line of output for new process
-            case 'p':
-            {
-                // Add last item
-                if (currentProcess && currentFile && !skip) {
-                    [currentProcess[@"children"] addObject:currentFile];
-                    currentFile = nil;
-                }
-                
-                // Set up new process dict
-                currentProcess = [Item new];
-                currentProcess[@"pid"] = value;
-                currentProcess[@"type"] = @"Process";
-                currentProcess[@"children"] = [NSMutableArray array];
-                [processList addObject:currentProcess];
-            }
-                break;
-                
-            // Process name
-            case 'c':
-                currentProcess[@"name"] = value;
-                currentProcess[@"displayname"] = value;
-                break;
-                
-            // Process UID
-            case 'u':
-                currentProcess[@"userid"] = value;
-                break;
-            
-            // Parent process ID
-            case 'R':
-            {
-                NSString *parentProcIDStr = value;
-                currentProcess[@"parentid"] = @([parentProcIDStr integerValue]);
-            }
-                break;
-            
-            // File descriptor - First line of output for a file
-            case 'f':
-            {
-                if (currentFile && !skip) {
-                    [currentProcess[@"children"] addObject:currentFile];
-                    currentFile = nil;
-                }
-                
-                // New file info starting, create new file dict
-                currentFile = [Item new];
-                NSString *fd = value;
-                currentFile[@"fd"] = fd;
-                if ([fd isEqualToString:@"err"]) {
-                    currentFile[@"type"] = @"Error";
-                    currentFile[@"image"] = [IconUtils imageNamed:@"Error"];
-                }
-                currentFile[@"pname"] = currentProcess[@"name"];
-                currentFile[@"pid"] = currentProcess[@"pid"];
-                currentFile[@"puserid"] = currentProcess[@"userid"];
-                
-                // txt files are program code, such as the application binary itself or a shared library
-                if ([fd isEqualToString:@"txt"] && ![DEFAULTS boolForKey:@"showProcessBinaries"]) {
-                    skip = YES;
-                }
-                // cwd and twd are current working directory and thread working directory, respectively
-                else if (([fd isEqualToString:@"cwd"] || [fd isEqualToString:@"twd"]) && ![DEFAULTS boolForKey:@"showCurrentWorkingDirectories"]) {
-                    skip = YES;
-                }
-                else {
-                    skip = NO;
-                }
-            }
-                break;
-            
-            // File access mode
-            case 'a':
-                currentFile[@"accessmode"] = value;
-                break;
-                
-            // File type
-            case 't':
-            {
-                NSString *ftype = value;
-                
-                if ([ftype isEqualToString:@"VREG"] || [ftype isEqualToString:@"REG"]) {
-                    currentFile[@"type"] = @"File";
-                }
-                else if ([ftype isEqualToString:@"VDIR"] || [ftype isEqualToString:@"DIR"]) {
-                    currentFile[@"type"] = @"Directory";
-                }
-                else if ([ftype isEqualToString:@"IPv6"] || [ftype isEqualToString:@"IPv4"]) {
-                    currentFile[@"type"] = @"IP Socket";
-                    currentFile[@"ipversion"] = ftype;
-                }
-                else  if ([ftype isEqualToString:@"unix"]) {
-                    currentFile[@"type"] = @"Unix Domain Socket";
-                }
-                else if ([ftype isEqualToString:@"VCHR"] || [ftype isEqualToString:@"CHR"]) {
-                    currentFile[@"type"] = @"Character Device";
-                }
-                else if ([ftype isEqualToString:@"PIPE"]) {
-                    currentFile[@"type"] = @"Pipe";
-                }
-                else {
-                    //DLog(@"Unrecognized file type: %@ : %@", ftype, [currentFile description]);
-                    skip = YES;
-                }
-                
-                if (currentFile[@"type"]) {
-                    NSImage *img = [IconUtils imageNamed:currentFile[@"type"]];
-                    if (img) {
-                        currentFile[@"image"] = img;
-                    }
-                }
-            }
-                break;
-            
-            // File name / path
-            case 'n':
-            {
-                currentFile[@"name"] = value;
-                currentFile[@"displayname"] = [currentFile[@"name"] length] ? currentFile[@"name"] : @"Unnamed";
-                
-                // Some files when running in root mode have no type listed
-                // and are only reported with the name "(revoked)". Skip those.
-                if (!currentFile[@"type"] && [currentFile[@"name"] isEqualToString:@"(revoked)"]) {
-                    skip = YES;
-                }
-                
-                if ([value hasSuffix:@"Operation not permitted"]) {
-                    currentFile[@"type"] = @"Error";
-                    currentFile[@"image"] = [IconUtils imageNamed:@"Error"];
-                }
-                
-                if ([currentFile[@"name"] hasPrefix:@"unknown file type:"]) {
-                    currentFile[@"image"] = [IconUtils imageNamed:@"QuestionMark"];
-                }
-            }
-                break;
-            
-            // Protocol (IP sockets only)
-            case 'P':
-                currentFile[@"protocol"] = value;
-                break;
-                
-            // TCP socket info (IP sockets only)
-            case 'T':
-            {
-                NSString *socketInfo = value;
-                if ([socketInfo hasPrefix:@"ST="]) {
-                    currentFile[@"socketstate"] = [socketInfo substringFromIndex:3];
-                    currentFile[@"displayname"] = [NSString stringWithFormat:@"%@ (%@)",
-                                                   currentFile[@"name"], currentFile[@"socketstate"]];
-                }
+#ifdef DEBUG
+        DLog(@"Read and parsed lsof output in %lu segments in %.3f sec",
+             (unsigned long)[parsers count], CFAbsoluteTimeGetCurrent() - startTime);
+#endif
+        parsers = [NSMutableArray arrayWithObject:[LsofParser new]];
+        return [LsofTask completeSnapshot:snapshot partial:(self.query.pids != nil)];
+    };
+    
+    NSMutableData *buffer = [NSMutableData dataWithCapacity:LSOF_PARSE_SEGMENT_SIZE + LSOF_READ_CHUNK_SIZE];
+    NSUInteger scanOffset = 0; // Where to continue looking for a marker line
+    BOOL hasOutput = NO; // Output since last marker
+    ssize_t len;
+    while (1) {
+        NSUInteger bufferLength = [buffer length];
+        [buffer setLength:bufferLength + LSOF_READ_CHUNK_SIZE];
+        len = read(fd, (char *)[buffer mutableBytes] + bufferLength, LSOF_READ_CHUNK_SIZE);
+        if (len <= 0) {
+            [buffer setLength:bufferLength];
+            if (len < 0 && errno == EINTR) {
+                continue;
             }
-                break;
-                
-            // Device character code
-            case 'd':
-            {
-                NSString *devCharCode = value;
-                currentFile[@"devcharcode"] = devCharCode;
-                if (devCharCodeMap[devCharCode] == nil) {
-                    devCharCodeMap[devCharCode] = [NSMutableArray new];
-                }
-                [devCharCodeMap[devCharCode] addObject:currentFile];
+            if (len < 0) {
+                DLog(@"Error reading lsof output: %s", strerror(errno));
             }
-                break;
-                
-            // File's major/minor device number (0x<hexadecimal>)
-            case 'D':
-            {
-                unsigned int deviceID;
-                NSString *deviceIDStr = value;
-                NSScanner *scanner = [NSScanner scannerWithString:deviceIDStr];
-                [scanner scanHexInt:&deviceID];
-                // Use device number to add file system info to file
-                currentFile[@"device"] = fileSystems[@(deviceID)] ? fileSystems[@(deviceID)] : @{ @"devid": @(deviceID) };
+            break;
+        }
+        [buffer setLength:bufferLength + len];
+        hasOutput = YES;
+        
+        if (self.stopped) {
+            break;
+        }
+        
+        // Each marker line ends an iteration in repeat mode
+        NSUInteger markerStart, markerEnd;
+        while (repeating && FindMarkerLine([buffer bytes], [buffer length], &scanOffset, &markerStart, &markerEnd)) {
+            if (markerStart > 0) {
+                parseSegment([parsers lastObject], buffer, markerStart);
             }
-                break;
+            NSMutableData *remainder = [NSMutableData dataWithCapacity:LSOF_PARSE_SEGMENT_SIZE + LSOF_READ_CHUNK_SIZE];
+            [remainder appendBytes:(const char *)[buffer bytes] + markerEnd length:[buffer length] - markerEnd];
+            buffer = remainder;
+            scanOffset = 0;
+            hasOutput = ([buffer length] > 0);
             
-            // File inode number
-            case 'i':
-            {
-                NSString *inodeNumStr = value;
-                currentFile[@"inode"] = @([inodeNumStr integerValue]);
+            Snapshot *snapshot = finishIteration();
+            if (self.stopped) {
+                return;
             }
-                break;
+            handler(snapshot);
+#ifdef DEBUG
+            startTime = CFAbsoluteTimeGetCurrent();
+#endif
+        }
+        
+        // Hand off segment once enough output has accumulated
+        if ([buffer length] < LSOF_PARSE_SEGMENT_SIZE) {
+            continue;
+        }
+        NSUInteger boundary = LastProcessBoundary([buffer bytes], [buffer length]);
+        if (boundary == 0) {
+            continue;
         }
+        
+        // Remainder goes into a new buffer, the segment is parsed in place
+        NSMutableData *remainder = [NSMutableData dataWithCapacity:LSOF_PARSE_SEGMENT_SIZE + LSOF_READ_CHUNK_SIZE];
+        [remainder appendBytes:(const char *)[buffer bytes] + boundary length:[buffer length] - boundary];
+        parseSegment([parsers lastObject], buffer, boundary);
+        [parsers addObject:[LsofParser new]];
+        buffer = remainder;
+        scanOffset = (scanOffset > boundary) ? scanOffset - boundary : 0;
     }
     
-    // Add the one remaining output item
-    if (currentProcess && currentFile && !skip) {
-        [currentProcess[@"children"] addObject:currentFile];
+    if (self.stopped) {
+        dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+        return;
     }
     
-    // Get additional info about the processes, count total number of files
-    for (NSMutableDictionary *process in processList) {
-        [LsofTask updateProcessInfo:process];
-        *numFiles += [process[@"children"] count];
-        
-        // Iterate over the process's children, map sockets and pipes to their endpoint
-        for (NSMutableDictionary *f in process[@"children"]) {
-            if (![f[@"type"] isEqualToString:@"Unix Domain Socket"] && ![f[@"type"] isEqualToString:@"Pipe"]) {
-                continue;
-            }
-            // Identifiable pipes and sockets should have names in the format "->[NAME]"
-            if ([f[@"name"] length] < 3) {
-                continue;
-            }
-            
-            NSString *name = [f[@"name"] substringFromIndex:2];
-            
-            // If we know which process owns the other end of the pipe/socket
-            // Needs to run with root privileges for successful lookup of the
-            // endpoints of system process pipes/sockets such as syslogd.
-            if (devCharCodeMap[name]) {
-                NSArray *endPoints = devCharCodeMap[name];
-                NSMutableArray *epItems = [NSMutableArray new];
-                NSDictionary *first = devCharCodeMap[name][0];
-                f[@"displayname"] = [NSString stringWithFormat:@"%@ (%@%@)",
-                                     f[@"displayname"], first[@"pname"],
-                                     [endPoints count] > 1 ? @" ..." : @""];
-                for (NSDictionary *e in endPoints) {
-                    NSString *i = [NSString stringWithFormat:@"%@ (%@)", e[@"pname"], e[@"pid"]];
-                    [epItems addObject:i];
-                }
-                f[@"endpoints"] = epItems;
-            }
-        }
+    if ([buffer length]) {
+        parseSegment([parsers lastObject], buffer, [buffer length]);
     }
     
-    return processList;
+    // Repeat mode output ends with a marker, so there is normally
+    // no output left over once a repeating lsof exits.
+    if (repeating && !hasOutput) {
+        dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+        return;
+    }
+    handler(finishIteration());
 }
 
 // Get additional info about process and
-// add it to the process info dictionary
-+ (void)updateProcessInfo:(NSMutableDictionary *)p {
-    
-    if (p[@"image"] == nil) {
-        pid_t pid = [p[@"pid"] intValue];
-        NSRunningApplication *app = [ProcessUtils appForPID:pid];
-        
-        if (app) {
-            p[@"bundle"] = @YES;
-            NSString *bundlePath = [[app bundleURL] path];
-            if (bundlePath) {
-                p[@"path"] = bundlePath;
-            }
-            p[@"image"] = [WORKSPACE iconForFile:p[@"path"]];
-            p[@"app"] = @([ProcessUtils isAppProcess:p[@"path"]]);
-            p[@"identifier"] = [ProcessUtils identifierForBundleAtPath:p[@"path"]];
-        } else {
-            p[@"image"] = [IconUtils imageNamed:@"GenericExecutable"];
-            p[@"bundle"] = @NO;
-            p[@"app"] = @NO;
-            p[@"path"] = [ProcessUtils executablePathForPID:pid];
-        }
-        
-//        if ([p[@"bundle"] boolValue]) {
-//            p[@"identifier"] = [ProcessUtils identifierForBundleAtPath:p[@"path"]];
-//        }
-        p[@"psn"] = [ProcessUtils carbonProcessSerialNumberForPID:pid];
-        
-        // On macOS, lsof truncates process names that are longer than
-        // 32 characters since it uses libproc. We can do better than that.
-        if ([DEFAULTS boolForKey:@"friendlyProcessNames"]) {
-            p[@"pname"] = [ProcessUtils macProcessNameForPID:pid];
-        }
-        if (!p[@"pname"]) {
-            p[@"pname"] = [ProcessUtils fullKernelProcessNameForPID:pid];
-        }
-        if (!p[@"pname"]) {
-            p[@"pname"] = [ProcessUtils procNameForPID:pid]; // libproc
-        }
-        if (!p[@"pname"]) {
-            p[@"pname"] = p[@"name"];
-        }
-        
-        // Set process icon for all children (i.e. files, sockets, etc.)
-        for (NSMutableDictionary *item in p[@"children"]) {
-            item[@"pimage"] = p[@"image"];
-            item[@"pname"] = p[@"pname"];
-        }
+// add it to the process record
++ (void)updateProcessInfo:(NSUInteger)index inSnapshot:(Snapshot *)snapshot friendlyNames:(BOOL)friendlyNames {
+    ProcessRecord *p = &snapshot.processes[index];
+    if (p->startTime == 0) {
+        p->startTime = [ProcessUtils startTimeForPID:p->pid];
+    }
+    if (p->uid == NO_UID) {
+        p->uid = [ProcessUtils tableUIDForPID:p->pid];
+    }
+    if (p->image != NO_REF) {
+        return;
     }
     
-    // Update display name to show number of open files for process
-    p[@"displayname"] = [NSString stringWithFormat:@"%@ (%lu)", p[@"pname"], [p[@"children"] count]];
+    ProcessMetadata *metadata = [[ProcessInfoCache sharedCache] metadataForPID:p->pid
+                                                                      startTime:p->startTime
+                                                                   friendlyName:friendlyNames];
+    p->path = [snapshot addString:metadata.path];
+    p->identifier = [snapshot addString:metadata.identifier];
+    p->image = [snapshot addObject:metadata.image];
+    p->psn = metadata.psn;
+    if (metadata.bundle) {
+        p->flags |= ProcessFlagBundle;
+    }
+    if (metadata.app) {
+        p->flags |= ProcessFlagApp;
+    }
+    // Falls back to the name reported by lsof if not set
+    p->pname = [snapshot addString:metadata.name];
 }
 
 - (NSMutableArray *)args {
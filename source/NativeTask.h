@@ -1,5 +1,5 @@
 /*
-    Copyright (c) 2003-2025, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
     All rights reserved.
 
     Redistribution and use in source and binary forms, with or without modification,
@@ -30,12 +30,14 @@
 
 @import Foundation;
 
+#import "SnapshotBackend.h"
+
 NS_ASSUME_NONNULL_BEGIN
 
-@interface MutableDictProxy : NSMutableDictionary
-{
-    NSMutableDictionary *properties;
-}
+// Enumerates open files in-process using libproc instead of running lsof.
+// Only sees processes the current user is allowed to inspect.
+@interface NativeTask : NSObject <SnapshotBackend>
+
 @end
 
 NS_ASSUME_NONNULL_END
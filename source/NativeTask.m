@@ -0,0 +1,342 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "NativeTask.h"
+
+#import "Common.h"
+#import "LsofTask.h"
+
+#import <libproc.h>
+#import <sys/proc_info.h>
+#import <sys/fcntl.h>
+#import <sys/stat.h>
+#import <arpa/inet.h>
+#import <netinet/in.h>
+
+// Names used by lsof for TCP states
+static const char *tcpStateNames[] = {
+    "CLOSED", "LISTEN", "SYN_SENT", "SYN_RECEIVED", "ESTABLISHED", "CLOSE_WAIT",
+    "FIN_WAIT_1", "CLOSING", "LAST_ACK", "FIN_WAIT_2", "TIME_WAIT"
+};
+
+@interface NativeTask ()
+{
+    Snapshot *snapshot;
+    
+    BOOL showProcessBinaries;
+    BOOL showCurrentWorkingDirectories;
+    
+    // Reused for all processes
+    struct proc_fdinfo *fdBuffer;
+    int fdBufferSize;
+}
+@property (atomic) BOOL stopped;
+@end
+
+@implementation NativeTask
+
+- (void)dealloc {
+    free(fdBuffer);
+}
+
+- (Snapshot * __nullable)launch:(AuthorizationRef __nullable)authRef {
+    DLog(@"Enumerating open files with libproc");
+#ifdef DEBUG
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+#endif
+    
+    snapshot = [Snapshot new];
+    showProcessBinaries = [DEFAULTS boolForKey:@"showProcessBinaries"];
+    showCurrentWorkingDirectories = [DEFAULTS boolForKey:@"showCurrentWorkingDirectories"];
+    
+    // Get all PIDs. Leave room for processes launched in the meantime.
+    int numPIDs = proc_listallpids(NULL, 0);
+    if (numPIDs <= 0) {
+        DLog(@"Failed to list processes: %s", strerror(errno));
+        return [LsofTask completeSnapshot:snapshot];
+    }
+    numPIDs += 64;
+    pid_t *pids = malloc(numPIDs * sizeof(pid_t));
+    if (pids == NULL) {
+        return [LsofTask completeSnapshot:snapshot];
+    }
+    numPIDs = proc_listallpids(pids, numPIDs * sizeof(pid_t));
+    
+    // List in ascending PID order, like lsof
+    qsort_b(pids, numPIDs, sizeof(pid_t), ^int(const void *a, const void *b) {
+        return *(const pid_t *)a - *(const pid_t *)b;
+    });
+    
+    for (int i = 0; i < numPIDs; i++) {
+        if (self.stopped) {
+            free(pids);
+            snapshot = nil;
+            return nil;
+        }
+        [self addProcess:pids[i]];
+    }
+    free(pids);
+    
+#ifdef DEBUG
+    DLog(@"Enumerated %lu processes, %lu files in %.3f sec",
+         (unsigned long)[snapshot processCount], (unsigned long)[snapshot fileCount],
+         CFAbsoluteTimeGetCurrent() - startTime);
+#endif
+    
+    Snapshot *result = snapshot;
+    snapshot = nil;
+    return [LsofTask completeSnapshot:result];
+}
+
+- (void)stop {
+    self.stopped = YES;
+}
+
+#pragma mark - Processes
+
+static inline ObjRef AddCString(Snapshot *snapshot, const char *str) {
+    return [snapshot addStringWithBytes:str length:strlen(str)];
+}
+
+- (void)addProcess:(pid_t)pid {
+    struct proc_bsdinfo info;
+    if (proc_pidinfo(pid, PROC_PIDTBSDINFO, 0, &info, sizeof(info)) != sizeof(info)) {
+        return; // Process exited or we don't have permission
+    }
+    
+    // Get file descriptors
+    int size = proc_pidinfo(pid, PROC_PIDLISTFDS, 0, NULL, 0);
+    if (size <= 0) {
+        return;
+    }
+    if (size > fdBufferSize) {
+        free(fdBuffer);
+        fdBufferSize = size * 2;
+        fdBuffer = malloc(fdBufferSize);
+        if (fdBuffer == NULL) {
+            fdBufferSize = 0;
+            return;
+        }
+    }
+    size = proc_pidinfo(pid, PROC_PIDLISTFDS, 0, fdBuffer, fdBufferSize);
+    if (size <= 0) {
+        return;
+    }
+    int numFDs = size / PROC_PIDLISTFD_SIZE;
+    
+    NSUInteger processIndex = [snapshot addProcess];
+    ProcessRecord *p = &snapshot.processes[processIndex];
+    p->pid = pid;
+    p->ppid = info.pbi_ppid;
+    p->uid = info.pbi_uid;
+    p->startTime = ((uint64_t)info.pbi_start_tvsec * 1000000) + info.pbi_start_tvusec;
+    p->name = AddCString(snapshot, info.pbi_name[0] ? info.pbi_name : info.pbi_comm);
+    
+    // Current working directory
+    if (showCurrentWorkingDirectories) {
+        struct proc_vnodepathinfo vpi;
+        if (proc_pidinfo(pid, PROC_PIDVNODEPATHINFO, 0, &vpi, sizeof(vpi)) == sizeof(vpi)) {
+            NSUInteger idx = [snapshot addFileToProcess:processIndex];
+            FileRecord *f = &snapshot.files[idx];
+            f->fdName = AddCString(snapshot, "cwd");
+            [self setVnodeInfo:&vpi.pvi_cdir forFile:f];
+        }
+    }
+    
+    // Program binary. lsof lists all mapped
+    // code files but we only list the executable.
+    if (showProcessBinaries) {
+        char path[PROC_PIDPATHINFO_MAXSIZE];
+        if (proc_pidpath(pid, path, sizeof(path)) > 0) {
+            NSUInteger idx = [snapshot addFileToProcess:processIndex];
+            FileRecord *f = &snapshot.files[idx];
+            f->fdName = AddCString(snapshot, "txt");
+            f->type = FileTypeFile;
+            f->accessMode = AccessModeRead;
+            f->name = AddCString(snapshot, path);
+        }
+    }
+    
+    for (int i = 0; i < numFDs; i++) {
+        [self addFile:&fdBuffer[i] pid:pid process:processIndex];
+    }
+}
+
+#pragma mark - Files
+
+- (void)addFile:(struct proc_fdinfo *)fdInfo pid:(pid_t)pid process:(NSUInteger)processIndex {
+    int fd = fdInfo->proc_fd;
+    
+    switch (fdInfo->proc_fdtype) {
+            
+        case PROX_FDTYPE_VNODE:
+        {
+            struct vnode_fdinfowithpath vi;
+            if (proc_pidfdinfo(pid, fd, PROC_PIDFDVNODEPATHINFO, &vi, sizeof(vi)) != sizeof(vi)) {
+                return;
+            }
+            mode_t mode = vi.pvip.vip_vi.vi_stat.vst_mode;
+            if (!S_ISREG(mode) && !S_ISDIR(mode) && !S_ISCHR(mode)) {
+                return;
+            }
+            FileRecord *f = [self addFile:fd openFlags:vi.pfi.fi_openflags process:processIndex];
+            [self setVnodeInfo:&vi.pvip forFile:f];
+        }
+            break;
+            
+        case PROX_FDTYPE_SOCKET:
+        {
+            struct socket_fdinfo si;
+            if (proc_pidfdinfo(pid, fd, PROC_PIDFDSOCKETINFO, &si, sizeof(si)) != sizeof(si)) {
+                return;
+            }
+            int family = si.psi.soi_family;
+            if (family == AF_INET || family == AF_INET6) {
+                FileRecord *f = [self addFile:fd openFlags:si.pfi.fi_openflags process:processIndex];
+                [self setIPSocketInfo:&si.psi forFile:f];
+            } else if (family == AF_UNIX) {
+                FileRecord *f = [self addFile:fd openFlags:si.pfi.fi_openflags process:processIndex];
+                [self setUnixSocketInfo:&si.psi forFile:f];
+            }
+        }
+            break;
+            
+        case PROX_FDTYPE_PIPE:
+        {
+            struct pipe_fdinfo pi;
+            if (proc_pidfdinfo(pid, fd, PROC_PIDFDPIPEINFO, &pi, sizeof(pi)) != sizeof(pi)) {
+                return;
+            }
+            FileRecord *f = [self addFile:fd openFlags:pi.pfi.fi_openflags process:processIndex];
+            f->type = FileTypePipe;
+            f->devCharCode = pi.pipeinfo.pipe_handle;
+            if (pi.pipeinfo.pipe_peerhandle) {
+                f->peerCharCode = pi.pipeinfo.pipe_peerhandle;
+                f->name = [snapshot addString:[NSString stringWithFormat:@"->0x%llx", f->peerCharCode]];
+            }
+        }
+            break;
+    }
+}
+
+- (FileRecord *)addFile:(int)fd openFlags:(uint32_t)flags process:(NSUInteger)processIndex {
+    NSUInteger idx = [snapshot addFileToProcess:processIndex];
+    FileRecord *f = &snapshot.files[idx];
+    f->fd = fd;
+    if ((flags & FREAD) && (flags & FWRITE)) {
+        f->accessMode = AccessModeReadWrite;
+    } else if (flags & FWRITE) {
+        f->accessMode = AccessModeWrite;
+    } else if (flags & FREAD) {
+        f->accessMode = AccessModeRead;
+    }
+    return f;
+}
+
+- (void)setVnodeInfo:(struct vnode_info_path *)vip forFile:(FileRecord *)f {
+    struct vinfo_stat *st = &vip->vip_vi.vi_stat;
+    if (S_ISDIR(st->vst_mode)) {
+        f->type = FileTypeDirectory;
+    } else if (S_ISCHR(st->vst_mode)) {
+        f->type = FileTypeCharDevice;
+    } else {
+        f->type = FileTypeFile;
+    }
+    f->name = AddCString(snapshot, vip->vip_path);
+    f->device = S_ISCHR(st->vst_mode) ? st->vst_rdev : st->vst_dev;
+    f->inode = st->vst_ino;
+    f->flags |= FileFlagHasDevice | FileFlagHasInode;
+}
+
+- (void)setIPSocketInfo:(struct socket_info *)si forFile:(FileRecord *)f {
+    f->type = FileTypeIPSocket;
+    f->ipVersion = (si->soi_family == AF_INET6) ? IPVersion6 : IPVersion4;
+    
+    struct in_sockinfo *ini;
+    if (si->soi_kind == SOCKINFO_TCP) {
+        f->protocol = AddCString(snapshot, "TCP");
+        ini = &si->soi_proto.pri_tcp.tcpsi_ini;
+        int state = si->soi_proto.pri_tcp.tcpsi_state;
+        if (state >= 0 && state < (int)(sizeof(tcpStateNames) / sizeof(tcpStateNames[0]))) {
+            f->socketState = AddCString(snapshot, tcpStateNames[state]);
+        }
+    } else {
+        f->protocol = AddCString(snapshot, (si->soi_protocol == IPPROTO_UDP) ? "UDP" : "IP");
+        ini = &si->soi_proto.pri_in;
+    }
+    
+    // Name in lsof format, e.g. 127.0.0.1:5000->127.0.0.1:52000
+    NSString *local = [self addressString:ini local:YES];
+    NSString *foreign = [self addressString:ini local:NO];
+    f->name = [snapshot addString:foreign ? [NSString stringWithFormat:@"%@->%@", local, foreign] : local];
+}
+
+- (NSString * __nullable)addressString:(struct in_sockinfo *)ini local:(BOOL)local {
+    int port = ntohs(local ? ini->insi_lport : ini->insi_fport);
+    char host[INET6_ADDRSTRLEN + 2] = "*"; // Room for brackets around IPv6 addresses
+    
+    if (ini->insi_vflag & INI_IPV4) {
+        struct in_addr addr = local ? ini->insi_laddr.ina_46.i46a_addr4 : ini->insi_faddr.ina_46.i46a_addr4;
+        if (addr.s_addr != INADDR_ANY) {
+            inet_ntop(AF_INET, &addr, host, sizeof(host));
+        }
+    } else {
+        struct in6_addr addr = local ? ini->insi_laddr.ina_6 : ini->insi_faddr.ina_6;
+        if (!IN6_IS_ADDR_UNSPECIFIED(&addr)) {
+            char addrStr[INET6_ADDRSTRLEN];
+            inet_ntop(AF_INET6, &addr, addrStr, sizeof(addrStr));
+            snprintf(host, sizeof(host), "[%s]", addrStr);
+        }
+    }
+    
+    if (!local && port == 0 && host[0] == '*') {
+        return nil; // No foreign address
+    }
+    if (port == 0) {
+        return [NSString stringWithFormat:@"%s:*", host];
+    }
+    return [NSString stringWithFormat:@"%s:%d", host, port];
+}
+
+- (void)setUnixSocketInfo:(struct socket_info *)si forFile:(FileRecord *)f {
+    f->type = FileTypeUnixSocket;
+    f->devCharCode = si->soi_so;
+    
+    struct un_sockinfo *un = &si->soi_proto.pri_un;
+    const char *path = un->unsi_addr.ua_sun.sun_path;
+    if (path[0]) {
+        f->name = [snapshot addStringWithBytes:path length:strnlen(path, sizeof(un->unsi_addr.ua_sun.sun_path))];
+    } else if (un->unsi_conn_so) {
+        f->peerCharCode = un->unsi_conn_so;
+        f->name = [snapshot addString:[NSString stringWithFormat:@"->0x%llx", f->peerCharCode]];
+    }
+}
+
+@end
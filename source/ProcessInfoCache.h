@@ -0,0 +1,65 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+@import Cocoa;
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Information about a process that doesn't change while it is running
+@interface ProcessMetadata : NSObject
+
+@property (nonatomic, copy, nullable) NSString *path;
+@property (nonatomic, copy, nullable) NSString *identifier;
+@property (nonatomic, copy, nullable) NSString *name;
+@property (nonatomic, strong) NSImage *image;
+@property (nonatomic) int32_t psn; // -1 if none
+@property (nonatomic) BOOL bundle;
+@property (nonatomic) BOOL app;
+
+@end
+
+// Caches process metadata across refreshes, so that it is only looked up
+// once for each process. Entries are keyed by PID and process start time,
+// so a reused PID is not mistaken for an earlier process.
+@interface ProcessInfoCache : NSObject
+
++ (instancetype)sharedCache;
+
+- (ProcessMetadata *)metadataForPID:(pid_t)pid startTime:(uint64_t)startTime friendlyName:(BOOL)friendlyName;
+
+// Drop entries for processes that have exited
+- (void)evictProcessesNotInSet:(NSSet<NSNumber *> *)pids;
+// Drop entries for processes that have exec'd a new image. Lookups
+// already in progress for them are not cached when they finish.
+- (void)evictProcesses:(NSIndexSet *)pids;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,197 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "ProcessInfoCache.h"
+
+#import "Common.h"
+#import "IconUtils.h"
+#import "ProcessUtils.h"
+
+@implementation ProcessMetadata
+@end
+
+@interface CacheEntry : NSObject
+@property (nonatomic) uint64_t startTime;
+@property (nonatomic) BOOL friendlyName;
+@property (nonatomic, strong) ProcessMetadata *metadata;
+@end
+
+@implementation CacheEntry
+@end
+
+@interface ProcessInfoCache ()
+{
+    NSMutableDictionary<NSNumber*, CacheEntry*> *entries;
+    
+    // Number of evictProcesses: calls, and the last one each PID was
+    // evicted in. Lookups that started before a PID was evicted must not
+    // be stored, since they may describe the image it had before exec.
+    NSUInteger evictionCount;
+    NSMutableDictionary<NSNumber*, NSNumber*> *lastEviction;
+    
+#ifdef DEBUG
+    NSUInteger hits;
+    NSUInteger misses;
+#endif
+}
+@end
+
+@implementation ProcessInfoCache
+
++ (instancetype)sharedCache {
+    static ProcessInfoCache *sharedCache = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCache = [ProcessInfoCache new];
+    });
+    return sharedCache;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        entries = [NSMutableDictionary new];
+        lastEviction = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+- (ProcessMetadata *)metadataForPID:(pid_t)pid startTime:(uint64_t)startTime friendlyName:(BOOL)friendlyName {
+    NSUInteger lookupStart;
+    @synchronized(self) {
+        lookupStart = evictionCount;
+        CacheEntry *entry = entries[@(pid)];
+        if (entry && startTime && entry.startTime == startTime && entry.friendlyName == friendlyName) {
+#ifdef DEBUG
+            hits += 1;
+#endif
+            return entry.metadata;
+        }
+    }
+    
+    // Look up outside the lock, this is slow
+    ProcessMetadata *metadata = [self lookUpMetadataForPID:pid friendlyName:friendlyName];
+    
+    // Without a start time we can't tell whether the PID has been reused
+    if (startTime == 0) {
+        return metadata;
+    }
+    
+    CacheEntry *entry = [CacheEntry new];
+    entry.startTime = startTime;
+    entry.friendlyName = friendlyName;
+    entry.metadata = metadata;
+    @synchronized(self) {
+        if ([lastEviction[@(pid)] unsignedIntegerValue] <= lookupStart) {
+            entries[@(pid)] = entry;
+        }
+#ifdef DEBUG
+        misses += 1;
+#endif
+    }
+    return metadata;
+}
+
+- (void)evictProcessesNotInSet:(NSSet<NSNumber *> *)pids {
+    @synchronized(self) {
+#ifdef DEBUG
+        NSUInteger count = [entries count];
+#endif
+        for (NSNumber *pid in [entries allKeys]) {
+            if (![pids containsObject:pid]) {
+                [entries removeObjectForKey:pid];
+            }
+        }
+        for (NSNumber *pid in [lastEviction allKeys]) {
+            if (![pids containsObject:pid]) {
+                [lastEviction removeObjectForKey:pid];
+            }
+        }
+#ifdef DEBUG
+        DLog(@"Process info cache: %lu hits, %lu misses, evicted %lu",
+             (unsigned long)hits, (unsigned long)misses, (unsigned long)(count - [entries count]));
+        hits = 0;
+        misses = 0;
+#endif
+    }
+}
+
+- (void)evictProcesses:(NSIndexSet *)pids {
+    @synchronized(self) {
+        evictionCount += 1;
+        [pids enumerateIndexesUsingBlock:^(NSUInteger pid, BOOL *stop) {
+            [self->entries removeObjectForKey:@((pid_t)pid)];
+            self->lastEviction[@((pid_t)pid)] = @(self->evictionCount);
+        }];
+    }
+}
+
+#pragma mark - Lookup
+
+- (ProcessMetadata *)lookUpMetadataForPID:(pid_t)pid friendlyName:(BOOL)friendlyName {
+    ProcessMetadata *metadata = [ProcessMetadata new];
+    NSRunningApplication *app = [ProcessUtils appForPID:pid];
+    
+    if (app) {
+        metadata.bundle = YES;
+        metadata.path = [[app bundleURL] path];
+        if (metadata.path) {
+            metadata.image = [WORKSPACE iconForFile:metadata.path];
+            metadata.app = [ProcessUtils isAppProcess:metadata.path];
+            metadata.identifier = [ProcessUtils identifierForBundleAtPath:metadata.path];
+        }
+    } else {
+        metadata.path = [ProcessUtils executablePathForPID:pid];
+    }
+    if (metadata.image == nil) {
+        metadata.image = [IconUtils imageNamed:@"GenericExecutable"];
+    }
+    
+    NSString *psn = [ProcessUtils carbonProcessSerialNumberForPID:pid];
+    metadata.psn = psn ? [psn intValue] : -1;
+    
+    // On macOS, lsof truncates process names that are longer than
+    // 32 characters since it uses libproc. We can do better than that.
+    NSString *pname = nil;
+    if (friendlyName) {
+        pname = [ProcessUtils macProcessNameForPID:pid];
+    }
+    if (!pname) {
+        pname = [ProcessUtils fullKernelProcessNameForPID:pid];
+    }
+    if (!pname) {
+        pname = [ProcessUtils procNameForPID:pid]; // libproc
+    }
+    metadata.name = pname;
+    
+    return metadata;
+}
+
+@end
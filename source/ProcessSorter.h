@@ -0,0 +1,73 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class Item;
+@class Snapshot;
+
+typedef NS_ENUM(NSUInteger, ProcessSortKey) {
+    ProcessSortKeyName = 0,
+    ProcessSortKeyPID,
+    ProcessSortKeyUserID,
+    ProcessSortKeyFileCount,
+    ProcessSortKeyType,
+    ProcessSortKeyPSN,
+    ProcessSortKeyIdentifier
+};
+
+// Sorts process items by an integer key. Keys that only depend on the
+// process record are computed once per snapshot, with names and bundle
+// identifiers replaced by their rank in collation order, and items are
+// then ordered by a radix sort on the keys.
+@interface ProcessSorter : NSObject
+
+@property (readonly) ProcessSortKey key;
+
+// Key for a value of the sortBy default, e.g. "process id"
++ (ProcessSortKey)keyForSortBy:(NSString * __nullable)sortBy;
+
+- (instancetype)initWithKey:(ProcessSortKey)key;
+
+// Items with equal keys keep their relative order
+- (NSMutableArray<Item *> *)sortedItems:(NSArray<Item *> *)items ascending:(BOOL)ascending;
+
+// Index at which to insert an item into sorted items to keep them sorted
+- (NSUInteger)insertionIndexForItem:(Item *)item inItems:(NSArray<Item *> *)items ascending:(BOOL)ascending;
+
+// Fewest items to remove from mostly sorted items, e.g. after some of
+// their keys have changed, for the rest to be in sorted order
+- (NSIndexSet *)indexesOfItemsOutOfOrder:(NSArray<Item *> *)items ascending:(BOOL)ascending;
+
+@end
+
+NS_ASSUME_NONNULL_END
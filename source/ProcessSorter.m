@@ -0,0 +1,310 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "ProcessSorter.h"
+
+#import "Common.h"
+#import "Item.h"
+#import "Snapshot.h"
+
+// Stable LSD radix sort of 32-bit keys in the high half of each element.
+// The low half holds the element's original position.
+static void RadixSort(uint64_t *elements, uint64_t *scratch, NSUInteger count) {
+    for (NSUInteger shift = 32; shift < 64; shift += 8) {
+        NSUInteger offsets[257] = { 0 };
+        for (NSUInteger i = 0; i < count; i++) {
+            offsets[((elements[i] >> shift) & 0xFF) + 1]++;
+        }
+        for (NSUInteger b = 0; b < 256; b++) {
+            offsets[b + 1] += offsets[b];
+        }
+        for (NSUInteger i = 0; i < count; i++) {
+            scratch[offsets[(elements[i] >> shift) & 0xFF]++] = elements[i];
+        }
+        uint64_t *tmp = elements;
+        elements = scratch;
+        scratch = tmp;
+    }
+    // An even number of passes leaves the result in the original array
+}
+
+@interface ProcessSorter ()
+{
+    // Key of each process record in a snapshot
+    Snapshot *keysSnapshot;
+    uint32_t *processKeys;
+}
+@end
+
+@implementation ProcessSorter
+
++ (ProcessSortKey)keyForSortBy:(NSString * __nullable)sortBy {
+    static NSDictionary<NSString*, NSNumber*> *keys;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        keys = @{
+            @"process id": @(ProcessSortKeyPID),
+            @"user id": @(ProcessSortKeyUserID),
+            @"file count": @(ProcessSortKeyFileCount),
+            @"process type": @(ProcessSortKeyType),
+            @"carbon psn": @(ProcessSortKeyPSN),
+            @"bundle identifier": @(ProcessSortKeyIdentifier)
+        };
+    });
+    // Default to sorting alphabetically by name
+    NSNumber *key = sortBy ? keys[sortBy] : nil;
+    return key ? [key unsignedIntegerValue] : ProcessSortKeyName;
+}
+
+- (instancetype)initWithKey:(ProcessSortKey)key {
+    self = [super init];
+    if (self) {
+        _key = key;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(processKeys);
+}
+
+#pragma mark - Keys
+
+- (const uint32_t *)keysForSnapshot:(Snapshot *)snapshot {
+    if (snapshot == keysSnapshot) {
+        return processKeys;
+    }
+    
+    NSUInteger count = [snapshot processCount];
+    free(processKeys);
+    processKeys = malloc(MAX(count, 1) * sizeof(uint32_t));
+    if (processKeys == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for sort keys"];
+    }
+    keysSnapshot = snapshot;
+    
+    const ProcessRecord *processes = snapshot.processes;
+    switch (_key) {
+        case ProcessSortKeyName:
+        case ProcessSortKeyIdentifier:
+            [self rankStringsOfSnapshot:snapshot];
+            break;
+        case ProcessSortKeyPID:
+            for (NSUInteger i = 0; i < count; i++) {
+                processKeys[i] = (uint32_t)processes[i].pid;
+            }
+            break;
+        case ProcessSortKeyUserID:
+            for (NSUInteger i = 0; i < count; i++) {
+                processKeys[i] = (processes[i].uid == NO_UID) ? 0 : processes[i].uid;
+            }
+            break;
+        case ProcessSortKeyType:
+            for (NSUInteger i = 0; i < count; i++) {
+                uint8_t flags = processes[i].flags;
+                processKeys[i] = ((flags & ProcessFlagBundle) ? 2 : 0) | ((flags & ProcessFlagApp) ? 1 : 0);
+            }
+            break;
+        case ProcessSortKeyPSN:
+            for (NSUInteger i = 0; i < count; i++) {
+                processKeys[i] = (processes[i].psn == -1) ? 0 : (uint32_t)processes[i].psn;
+            }
+            break;
+        case ProcessSortKeyFileCount:
+            // Depends on the filtered files, see keyForItem:
+            break;
+    }
+    return processKeys;
+}
+
+// Key each process by the rank of its name or bundle identifier, so that
+// each distinct string is compared only while computing the ranks
+- (void)rankStringsOfSnapshot:(Snapshot *)snapshot {
+    BOOL byName = (_key == ProcessSortKeyName);
+    const ProcessRecord *processes = snapshot.processes;
+    NSUInteger count = [snapshot processCount];
+    
+    // Strings are interned, so equal strings have the same handle
+    uint32_t *ranks = calloc([snapshot stringCount] + 1, sizeof(uint32_t));
+    if (ranks == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for sort keys"];
+    }
+    NSMutableArray<NSNumber *> *refs = [NSMutableArray new];
+    for (NSUInteger i = 0; i < count; i++) {
+        const ProcessRecord *p = &processes[i];
+        ObjRef ref = byName ? (p->pname != NO_REF ? p->pname : p->name) : p->identifier;
+        if (ref != NO_REF && ranks[ref] == 0) {
+            ranks[ref] = 1;
+            [refs addObject:@(ref)];
+        }
+    }
+    
+    NSMutableArray<NSString *> *strings = [NSMutableArray arrayWithCapacity:[refs count]];
+    for (NSNumber *ref in refs) {
+        [strings addObject:[snapshot stringForRef:[ref unsignedIntValue]]];
+    }
+    NSComparator compare = ^NSComparisonResult(NSString *a, NSString *b) {
+        return byName ? [a localizedCaseInsensitiveCompare:b] : [a caseInsensitiveCompare:b];
+    };
+    NSMutableArray<NSNumber *> *order = [NSMutableArray arrayWithCapacity:[refs count]];
+    for (NSUInteger i = 0; i < [refs count]; i++) {
+        [order addObject:@(i)];
+    }
+    [order sortUsingComparator:^NSComparisonResult(NSNumber *a, NSNumber *b) {
+        return compare(strings[[a unsignedIntegerValue]], strings[[b unsignedIntegerValue]]);
+    }];
+    
+    // Strings that compare as equal share a rank. Missing strings rank first.
+    uint32_t rank = 0;
+    NSString *previous = nil;
+    for (NSNumber *i in order) {
+        NSString *str = strings[[i unsignedIntegerValue]];
+        if (previous == nil || compare(previous, str) != NSOrderedSame) {
+            rank++;
+        }
+        ranks[[refs[[i unsignedIntegerValue]] unsignedIntValue]] = rank;
+        previous = str;
+    }
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        const ProcessRecord *p = &processes[i];
+        ObjRef ref = byName ? (p->pname != NO_REF ? p->pname : p->name) : p->identifier;
+        processKeys[i] = (ref == NO_REF) ? 0 : ranks[ref];
+    }
+    free(ranks);
+}
+
+- (uint32_t)keyForItem:(Item *)item {
+    if (_key == ProcessSortKeyFileCount) {
+        return (uint32_t)[item numChildren];
+    }
+    return [self keysForSnapshot:item.snapshot][item.index];
+}
+
+#pragma mark - Sort
+
+- (NSMutableArray<Item *> *)sortedItems:(NSArray<Item *> *)items ascending:(BOOL)ascending {
+#ifdef DEBUG
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+#endif
+    NSUInteger count = [items count];
+    uint64_t *elements = malloc(MAX(count, 1) * sizeof(uint64_t));
+    uint64_t *scratch = malloc(MAX(count, 1) * sizeof(uint64_t));
+    if (elements == NULL || scratch == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for sort"];
+    }
+    for (NSUInteger i = 0; i < count; i++) {
+        elements[i] = ((uint64_t)[self keyForItem:items[i]] << 32) | i;
+    }
+    RadixSort(elements, scratch, count);
+    free(scratch);
+    
+    // Descending order is the same permutation reversed
+    NSMutableArray<Item *> *sorted = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        uint64_t e = elements[ascending ? i : count - 1 - i];
+        [sorted addObject:items[(NSUInteger)(e & UINT32_MAX)]];
+    }
+    free(elements);
+    
+#ifdef DEBUG
+    DLog(@"Sorted %lu processes in %.3f sec", (unsigned long)count, CFAbsoluteTimeGetCurrent() - start);
+#endif
+    return sorted;
+}
+
+- (NSUInteger)insertionIndexForItem:(Item *)item inItems:(NSArray<Item *> *)items ascending:(BOOL)ascending {
+    uint32_t key = [self keyForItem:item];
+    NSUInteger lo = 0;
+    NSUInteger hi = [items count];
+    while (lo < hi) {
+        NSUInteger mid = lo + (hi - lo) / 2;
+        uint32_t k = [self keyForItem:items[mid]];
+        if (ascending ? (k <= key) : (k >= key)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Items not in the longest sorted subsequence. Found by patience sorting:
+// tails[n] is the index of the item ending the best subsequence of
+// length n + 1 so far, and prev links each item to the one before it.
+- (NSIndexSet *)indexesOfItemsOutOfOrder:(NSArray<Item *> *)items ascending:(BOOL)ascending {
+    NSUInteger count = [items count];
+    NSMutableIndexSet *outOfOrder = [NSMutableIndexSet indexSetWithIndexesInRange:NSMakeRange(0, count)];
+    if (count == 0) {
+        return outOfOrder;
+    }
+    
+    uint32_t *keys = malloc(count * sizeof(uint32_t));
+    NSUInteger *tails = malloc(count * sizeof(NSUInteger));
+    NSUInteger *prev = malloc(count * sizeof(NSUInteger));
+    if (keys == NULL || tails == NULL || prev == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for sort keys"];
+    }
+    for (NSUInteger i = 0; i < count; i++) {
+        uint32_t key = [self keyForItem:items[i]];
+        keys[i] = ascending ? key : UINT32_MAX - key;
+    }
+    
+    NSUInteger length = 0;
+    for (NSUInteger i = 0; i < count; i++) {
+        // First subsequence whose last key is greater, so equal keys extend it
+        NSUInteger lo = 0;
+        NSUInteger hi = length;
+        while (lo < hi) {
+            NSUInteger mid = lo + (hi - lo) / 2;
+            if (keys[tails[mid]] <= keys[i]) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        prev[i] = lo ? tails[lo - 1] : NSNotFound;
+        tails[lo] = i;
+        if (lo == length) {
+            length++;
+        }
+    }
+    
+    for (NSUInteger i = tails[length - 1]; i != NSNotFound; i = prev[i]) {
+        [outOfOrder removeIndex:i];
+    }
+    
+    free(keys);
+    free(tails);
+    free(prev);
+    return outOfOrder;
+}
+
+@end
@@ -0,0 +1,262 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "ProcessWatcher.h"
+
+#import "Common.h"
+
+#import <sys/event.h>
+#import <libproc.h>
+
+#define EVENT_COALESCE_INTERVAL 0.25 // sec
+#define KEVENT_BATCH_SIZE       256
+
+@interface ProcessWatcher ()
+{
+    void (^handler)(NSIndexSet *, NSIndexSet *, NSIndexSet *);
+    dispatch_queue_t queue;
+    dispatch_source_t source;
+    int kq;
+    
+    // Only accessed on the watcher queue
+    NSMutableIndexSet *watched;
+    NSMutableIndexSet *knownPIDs; // All PIDs when last listed
+    NSMutableIndexSet *exited;
+    NSMutableIndexSet *execed;
+    BOOL forked;
+    BOOL flushScheduled;
+}
+@end
+
+@implementation ProcessWatcher
+
+- (instancetype)initWithHandler:(void (^)(NSIndexSet *exited, NSIndexSet *started, NSIndexSet *execed))h {
+    self = [super init];
+    if (self) {
+        handler = [h copy];
+        queue = dispatch_queue_create("org.sveinbjorn.Sloth.processwatcher", DISPATCH_QUEUE_SERIAL);
+        watched = [NSMutableIndexSet indexSet];
+        exited = [NSMutableIndexSet indexSet];
+        execed = [NSMutableIndexSet indexSet];
+        
+        kq = kqueue();
+        if (kq == -1) {
+            DLog(@"Failed to create kqueue: %s", strerror(errno));
+            return self;
+        }
+        // The kqueue is readable when it has pending events
+        source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, kq, 0, queue);
+        __weak ProcessWatcher *weakSelf = self;
+        dispatch_source_set_event_handler(source, ^{
+            [weakSelf readEvents];
+        });
+        int fd = kq;
+        dispatch_source_set_cancel_handler(source, ^{
+            close(fd);
+        });
+        dispatch_resume(source);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self stop];
+}
+
+- (void)stop {
+    if (source && !dispatch_source_testcancel(source)) {
+        dispatch_source_cancel(source);
+    }
+}
+
+- (BOOL)isStopped {
+    return (source == nil || dispatch_source_testcancel(source));
+}
+
+// PIDs of all processes, or nil on failure
+static NSMutableIndexSet * __nullable ListAllPIDs(void) {
+    // Leave room for processes launched in the meantime
+    int numPIDs = proc_listallpids(NULL, 0);
+    if (numPIDs <= 0) {
+        return nil;
+    }
+    numPIDs += 64;
+    pid_t *pids = malloc(numPIDs * sizeof(pid_t));
+    if (pids == NULL) {
+        return nil;
+    }
+    numPIDs = proc_listallpids(pids, numPIDs * sizeof(pid_t));
+    NSMutableIndexSet *set = [NSMutableIndexSet indexSet];
+    for (int i = 0; i < numPIDs; i++) {
+        if (pids[i] > 0) {
+            [set addIndex:pids[i]];
+        }
+    }
+    free(pids);
+    return set;
+}
+
+#pragma mark - Registration
+
+- (void)watchProcesses:(NSIndexSet *)pids {
+    NSIndexSet *pidsToWatch = [pids copy];
+    dispatch_async(queue, ^{
+        if ([self isStopped]) {
+            return;
+        }
+        if (self->knownPIDs == nil) {
+            self->knownPIDs = ListAllPIDs();
+        }
+        [self->knownPIDs addIndexes:pidsToWatch];
+        
+        NSMutableIndexSet *removed = [self->watched mutableCopy];
+        [removed removeIndexes:pidsToWatch];
+        NSMutableIndexSet *added = [pidsToWatch mutableCopy];
+        [added removeIndexes:self->watched];
+        [added removeIndex:0]; // The kernel can't be watched
+        
+        [self changeProcesses:removed flags:EV_DELETE];
+        [self changeProcesses:added flags:EV_ADD];
+        DLog(@"Watching %lu processes", (unsigned long)[self->watched count]);
+    });
+}
+
+// Add or delete events for processes in batches. Each change gets a
+// receipt, so failing changes don't stop the rest of the batch.
+- (void)changeProcesses:(NSIndexSet *)pids flags:(uint16_t)flags {
+    if ([pids count] == 0) {
+        return;
+    }
+    NSUInteger buffer[KEVENT_BATCH_SIZE];
+    struct kevent changes[KEVENT_BATCH_SIZE];
+    struct kevent receipts[KEVENT_BATCH_SIZE];
+    NSRange range = NSMakeRange([pids firstIndex], [pids lastIndex] - [pids firstIndex] + 1);
+    NSUInteger count;
+    while ((count = [pids getIndexes:buffer maxCount:KEVENT_BATCH_SIZE inIndexRange:&range]) > 0) {
+        for (NSUInteger i = 0; i < count; i++) {
+            EV_SET(&changes[i], buffer[i], EVFILT_PROC, flags | EV_RECEIPT, NOTE_EXIT | NOTE_FORK | NOTE_EXEC, 0, NULL);
+        }
+        int n = kevent(kq, changes, (int)count, receipts, (int)count, NULL);
+        if (n < 0) {
+            DLog(@"Failed to change process events: %s", strerror(errno));
+            return;
+        }
+        for (int i = 0; i < n; i++) {
+            pid_t pid = (pid_t)receipts[i].ident;
+            BOOL failed = (receipts[i].flags & EV_ERROR) && receipts[i].data != 0;
+            if ((flags & EV_ADD) && !failed) {
+                [watched addIndex:pid];
+                continue;
+            }
+            [watched removeIndex:pid];
+            // Exited before it could be watched
+            if ((flags & EV_ADD) && receipts[i].data == ESRCH) {
+                [exited addIndex:pid];
+                [self scheduleFlush];
+            }
+        }
+    }
+}
+
+#pragma mark - Events
+
+- (void)readEvents {
+    struct kevent events[KEVENT_BATCH_SIZE];
+    struct timespec timeout = { 0, 0 };
+    int n = kevent(kq, NULL, 0, events, KEVENT_BATCH_SIZE, &timeout);
+    if (n <= 0) {
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        pid_t pid = (pid_t)events[i].ident;
+        uint32_t fflags = events[i].fflags;
+        if (fflags & NOTE_FORK) {
+            forked = YES;
+        }
+        // Events for an exited process are removed from the kqueue
+        if (fflags & NOTE_EXIT) {
+            [watched removeIndex:pid];
+            [execed removeIndex:pid];
+            [exited addIndex:pid];
+        } else if (fflags & NOTE_EXEC) {
+            [execed addIndex:pid];
+        }
+    }
+    [self scheduleFlush];
+}
+
+- (void)scheduleFlush {
+    if (flushScheduled) {
+        return;
+    }
+    flushScheduled = YES;
+    __weak ProcessWatcher *weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(EVENT_COALESCE_INTERVAL * NSEC_PER_SEC)), queue, ^{
+        [weakSelf flush];
+    });
+}
+
+- (void)flush {
+    flushScheduled = NO;
+    if ([self isStopped]) {
+        return;
+    }
+    
+    // Processes forked since PIDs were last listed
+    NSMutableIndexSet *started = [NSMutableIndexSet indexSet];
+    if (forked) {
+        forked = NO;
+        NSMutableIndexSet *allPIDs = ListAllPIDs();
+        if (allPIDs) {
+            [started addIndexes:allPIDs];
+            [started removeIndexes:knownPIDs];
+            knownPIDs = allPIDs;
+        }
+    }
+    // PIDs may be reused
+    [knownPIDs removeIndexes:exited];
+    
+    if ([exited count] == 0 && [started count] == 0 && [execed count] == 0) {
+        return;
+    }
+    NSIndexSet *exitedPIDs = [exited copy];
+    NSIndexSet *execedPIDs = [execed copy];
+    [exited removeAllIndexes];
+    [execed removeAllIndexes];
+    DLog(@"Process events: %lu exited, %lu started, %lu exec'd",
+         (unsigned long)[exitedPIDs count], (unsigned long)[started count], (unsigned long)[execedPIDs count]);
+    
+    void (^h)(NSIndexSet *, NSIndexSet *, NSIndexSet *) = handler;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        h(exitedPIDs, started, execedPIDs);
+    });
+}
+
+@end
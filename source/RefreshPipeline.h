@@ -0,0 +1,77 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+@import Foundation;
+@import Security;
+
+#import "Snapshot.h"
+#import "SnapshotBackend.h"
+#import "SnapshotDiff.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class Item;
+
+// Builds new snapshots in the background in stages: the backend lists open
+// files (spawning lsof and parsing its output as it streams in), adds process
+// info, then items are created and the snapshot is diffed against the one
+// shown. Each refresh gets a generation number. Starting a refresh cancels
+// the one in progress, which stops its backend and drops its results at the
+// next stage boundary. Refreshes run one at a time on a serial queue.
+@interface RefreshPipeline : NSObject
+
+// Whether a refresh is in progress. Main thread only.
+@property (readonly, getter=isRunning) BOOL running;
+
+// Completion handler is called on the main thread, unless the refresh is
+// cancelled. Diff is nil if there is no previous snapshot. If the backend
+// fails, snapshot, items and diff are all nil.
+- (void)refreshWithBackend:(id<SnapshotBackend>)backend
+                   authRef:(AuthorizationRef __nullable)authRef
+              fromSnapshot:(Snapshot * __nullable)previous
+                completion:(void (^)(Snapshot * __nullable snapshot,
+                                     NSMutableArray<Item *> * __nullable items,
+                                     SnapshotDiff * __nullable diff))completion;
+
+// Refresh only the processes with the given PIDs, by merging a partial
+// snapshot listing them into the current one. Processes the backend
+// doesn't list, e.g. because they have exited, are removed. If backend
+// is nil, the processes are removed without listing anything.
+- (void)refreshProcesses:(NSIndexSet *)pids
+              ofSnapshot:(Snapshot *)snapshot
+             withBackend:(id<SnapshotBackend> __nullable)backend
+                 authRef:(AuthorizationRef __nullable)authRef
+              completion:(void (^)(Snapshot * __nullable snapshot,
+                                   NSMutableArray<Item *> * __nullable items,
+                                   SnapshotDiff * __nullable diff))completion;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,191 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "RefreshPipeline.h"
+
+#import "Common.h"
+#import "Item.h"
+
+#import <stdatomic.h>
+
+@interface RefreshPipeline ()
+{
+    dispatch_queue_t queue;
+    atomic_ulong latestGeneration;
+    
+    // Whether a refresh is in progress, and its backend. Main thread only.
+    BOOL running;
+    id<SnapshotBackend> _Nullable runningBackend;
+}
+@end
+
+@implementation RefreshPipeline
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        queue = dispatch_queue_create("org.sveinbjorn.Sloth.refresh",
+                                      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_USER_INITIATED, 0));
+        atomic_init(&latestGeneration, 0);
+    }
+    return self;
+}
+
+- (BOOL)isRunning {
+    return running;
+}
+
+- (BOOL)isCancelled:(unsigned long)generation {
+    return atomic_load_explicit(&latestGeneration, memory_order_relaxed) != generation;
+}
+
+// Stopping lsof ends its output, so a cancelled refresh
+// doesn't hold up the next one on the refresh queue
+- (void)stopRunningBackend {
+    if ([runningBackend respondsToSelector:@selector(stop)]) {
+        [runningBackend stop];
+    }
+    runningBackend = nil;
+}
+
+- (void)refreshWithBackend:(id<SnapshotBackend>)backend
+                   authRef:(AuthorizationRef __nullable)authRef
+              fromSnapshot:(Snapshot * __nullable)previous
+                completion:(void (^)(Snapshot * __nullable snapshot,
+                                     NSMutableArray<Item *> * __nullable items,
+                                     SnapshotDiff * __nullable diff))completion {
+    [self runBackend:backend fromSnapshot:previous listFiles:^Snapshot *{
+        return [backend launch:authRef];
+    } completion:completion];
+}
+
+- (void)refreshProcesses:(NSIndexSet *)pids
+              ofSnapshot:(Snapshot *)snapshot
+             withBackend:(id<SnapshotBackend> __nullable)backend
+                 authRef:(AuthorizationRef __nullable)authRef
+              completion:(void (^)(Snapshot * __nullable snapshot,
+                                   NSMutableArray<Item *> * __nullable items,
+                                   SnapshotDiff * __nullable diff))completion {
+    [self runBackend:backend fromSnapshot:snapshot listFiles:^Snapshot *{
+        Snapshot *partial = backend ? [backend launch:authRef] : [Snapshot new];
+        if (partial == nil) {
+            return nil;
+        }
+        Snapshot *merged = [snapshot snapshotByReplacingProcesses:pids withSnapshot:partial];
+        [merged resolveEndpoints];
+        return merged;
+    } completion:completion];
+}
+
+- (void)runBackend:(id<SnapshotBackend> __nullable)backend
+      fromSnapshot:(Snapshot * __nullable)previous
+         listFiles:(Snapshot * __nullable (^)(void))listFiles
+        completion:(void (^)(Snapshot * __nullable snapshot,
+                             NSMutableArray<Item *> * __nullable items,
+                             SnapshotDiff * __nullable diff))completion {
+    // Bump the generation first, so the refresh being stopped
+    // sees it has been cancelled when its backend returns
+    unsigned long generation = atomic_fetch_add(&latestGeneration, 1) + 1;
+    [self stopRunningBackend];
+    running = YES;
+    runningBackend = backend;
+    
+    dispatch_async(queue, ^{
+        @autoreleasepool {
+            if ([self isCancelled:generation]) {
+                DLog(@"Refresh cancelled before start (generation %lu)", generation);
+                return;
+            }
+#ifdef DEBUG
+            CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+            CFAbsoluteTime stageTime = startTime;
+#endif
+            // Spawn, stream parse and enrich
+            Snapshot *snapshot = listFiles();
+            if (snapshot == nil && ![self isCancelled:generation]) {
+                DLog(@"Refresh failed (generation %lu)", generation);
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    if ([self isCancelled:generation]) {
+                        return;
+                    }
+                    self->running = NO;
+                    self->runningBackend = nil;
+                    completion(nil, nil, nil);
+                });
+                return;
+            }
+            if ([self isCancelled:generation]) {
+                DLog(@"Refresh cancelled while listing files (generation %lu)", generation);
+                return;
+            }
+#ifdef DEBUG
+            DLog(@"Listed %lu processes, %lu files in %.3f sec", (unsigned long)[snapshot processCount],
+                 (unsigned long)[snapshot fileCount], CFAbsoluteTimeGetCurrent() - stageTime);
+            stageTime = CFAbsoluteTimeGetCurrent();
+#endif
+            
+            NSMutableArray<Item *> *items = [Item itemsForSnapshot:snapshot];
+            if ([self isCancelled:generation]) {
+                DLog(@"Refresh cancelled while creating items (generation %lu)", generation);
+                return;
+            }
+#ifdef DEBUG
+            DLog(@"Created %lu process items in %.3f sec", (unsigned long)[items count], CFAbsoluteTimeGetCurrent() - stageTime);
+            stageTime = CFAbsoluteTimeGetCurrent();
+#endif
+            
+            SnapshotDiff *diff = previous ? [SnapshotDiff diffFromSnapshot:previous toSnapshot:snapshot] : nil;
+#ifdef DEBUG
+            if (diff) {
+                DLog(@"Diffed snapshots in %.3f sec", CFAbsoluteTimeGetCurrent() - stageTime);
+            }
+#endif
+            
+            dispatch_async(dispatch_get_main_queue(), ^{
+                if ([self isCancelled:generation]) {
+                    DLog(@"Refresh cancelled before publishing (generation %lu)", generation);
+                    return;
+                }
+                self->running = NO;
+                self->runningBackend = nil;
+#ifdef DEBUG
+                CFAbsoluteTime publishTime = CFAbsoluteTimeGetCurrent();
+#endif
+                completion(snapshot, items, diff);
+#ifdef DEBUG
+                DLog(@"Published snapshot in %.3f sec, refresh took %.3f sec",
+                     CFAbsoluteTimeGetCurrent() - publishTime, CFAbsoluteTimeGetCurrent() - startTime);
+#endif
+            });
+        }
+    });
+}
+
+@end
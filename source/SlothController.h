@@ -34,6 +34,8 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class Item;
+
 @interface SlothController : NSObject <NSApplicationDelegate,
                                        NSWindowDelegate,
                                        NSOutlineViewDataSource,
@@ -43,7 +45,7 @@ NS_ASSUME_NONNULL_BEGIN
                                        VolumesPopUpButtonDelegate,
                                        NSPathControlDelegate>
 - (IBAction)kill:(id _Nullable)sender;
-- (void)revealItemInFinder:(NSDictionary *)item;
+- (void)revealItemInFinder:(Item *)item;
 @end
 
 NS_ASSUME_NONNULL_END
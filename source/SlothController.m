@@ -32,17 +32,30 @@
 
 #import "Common.h"
 #import "Alerts.h"
-#import "NSString+RegexConvenience.h"
 #import "InfoPanelController.h"
 #import "SettingsController.h"
 #import "ProcessUtils.h"
 #import "IconUtils.h"
-#import "FSUtils.h"
 #import "NSWorkspace+Additions.h"
 #import "STPrivilegedTask.h"
 #import "LsofTask.h"
+#import "NativeTask.h"
+#import "SnapshotBackend.h"
+#import "SnapshotDiff.h"
+#import "FilterEngine.h"
+#import "RefreshPipeline.h"
+#import "ProcessWatcher.h"
+#import "ProcessInfoCache.h"
+#import "ProcessSorter.h"
+#import "TrigramIndex.h"
 #import "Item.h"
 
+// Above this many new processes, a full refresh is cheaper than listing them
+#define MAX_PROCESS_RESCAN  64
+// How long to wait for a killed process to exit before listing it again
+#define KILL_EXIT_TIMEOUT   1.0 // sec
+
+
 @interface SlothController ()
 {
     __weak IBOutlet NSWindow *window;
@@ -81,18 +94,46 @@
     
     AuthorizationRef _Nullable authRef;
     BOOL authenticated;
-    BOOL isRefreshing;
+    
+    RefreshPipeline *refreshPipeline;
+    // Set when the update timer fires during a refresh, so
+    // that another one is started once it has finished
+    BOOL refreshPending;
+    LsofQuery * _Nullable refreshQuery;
     
     NSTimer * _Nullable filterTimer;
+    FilterEngine *filterEngine;
+    ProcessSorter * _Nullable sorter;
+    BOOL sortedAscending;
+    
+    // Processes are expanded if expandAll is set, except those the user
+    // has toggled, which are kept by PID across refreshes and filtering
+    BOOL expandAll;
+    BOOL applyingExpansion;
+    NSMutableSet<NSNumber *> *toggledProcesses;
+    LsofTask * _Nullable updateSession;
     NSTimer * _Nullable updateTimer;
     
+    // Between updates, processes that exit are removed and new
+    // or exec'd ones are listed as soon as they are reported
+    ProcessWatcher * _Nullable processWatcher;
+    NSMutableIndexSet *exitedProcesses;
+    NSMutableIndexSet *processesToRescan;
+    
+    // What the current snapshot was told to list
+    LsofQuery * _Nullable snapshotQuery;
+    
+    // Snapshot of the items currently shown, and changes since then
+    Snapshot * _Nullable displayedSnapshot;
+    SnapshotDiff * _Nullable pendingDiff;
+    
     InfoPanelController * _Nullable infoPanelController;
     SettingsController * _Nullable settingsController;
 }
 @property NSInteger totalFileCount;
-@property (nonatomic, strong) IBOutlet NSMutableArray<Item*> *content;
+@property (nonatomic, strong) Snapshot *snapshot;
+@property (nonatomic, strong) NSMutableArray<Item*> *content;
 @property (nonatomic, strong) NSMutableArray<Item*> *unfilteredContent;
-@property (nonatomic, strong) NSArray<NSSortDescriptor*> *sortDescriptors;
 
 @end
 
@@ -101,6 +142,11 @@
 - (instancetype)init {
     if ((self = [super init])) {
         _content = [[NSMutableArray alloc] init];
+        filterEngine = [FilterEngine new];
+        refreshPipeline = [RefreshPipeline new];
+        toggledProcesses = [NSMutableSet new];
+        exitedProcesses = [NSMutableIndexSet indexSet];
+        processesToRescan = [NSMutableIndexSet indexSet];
     }
     return self;
 }
@@ -198,6 +244,9 @@
     [outlineView setDoubleAction:@selector(rowDoubleClicked:)];
     [outlineView setDraggingSourceOperationMask:NSDragOperationEvery forLocal:NO];
     [outlineView.outlineTableColumn setWidth:outlineView.bounds.size.width];
+    [outlineView setRowSizeStyle:NSTableViewRowSizeStyleCustom];
+    [self updateRowHeight];
+    expandAll = [DEFAULTS boolForKey:@"disclosure"];
     
     [self updateDiscloseControl];
     [self updateSorting];
@@ -209,7 +258,15 @@
         // Refresh immediately when app is launched
         [self refresh:self];
     }
-    [self setUpdateTimerFromDefaults]; // If period update has been set in defaults
+    [self setUpdateSessionFromDefaults]; // If period update has been set in defaults
+    
+#ifdef DEBUG
+    if ([DEFAULTS boolForKey:@"benchmarkBackends"]) {
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+            [SnapshotBackends benchmark];
+        });
+    }
+#endif
 }
 
 - (NSMenu *)applicationDockMenu:(NSApplication *)sender {
@@ -241,67 +298,236 @@
 
 #pragma mark - Run lsof task
 
+// The current snapshot stays on display and can be filtered while the next
+// one is built. A refresh replaces any refresh in progress, except when the
+// update timer fires, in which case it waits for the current one to finish.
 - (IBAction)refresh:(id)sender {
-    if (isRefreshing) {
+    if (sender == updateTimer && [refreshPipeline isRunning]) {
+        refreshPending = YES;
         return;
     }
-    isRefreshing = YES;
-    [numItemsTextField setStringValue:@"Refreshing..."];
-    [outlineView deselectAll:self];
+    refreshPending = NO;
     
-    // Disable controls
-    [refreshButton setEnabled:NO];
-    [outlineView setEnabled:NO];
-    [outlineView setAlphaValue:0.5];
+    if (self.snapshot == nil) {
+        [numItemsTextField setStringValue:@"Refreshing..."];
+    }
     [authenticateButton setEnabled:NO];
-    
-    // Center progress indicator and set it off
-    CGFloat x = (NSWidth([window.contentView bounds]) - NSWidth([progressIndicator frame])) / 2;
-    CGFloat y = (NSHeight([window.contentView bounds]) - NSHeight([progressIndicator frame])) / 2;
-    [progressIndicator setFrameOrigin:NSMakePoint(x,y)];
-    [progressIndicator setAutoresizingMask:NSViewMinXMargin | NSViewMaxXMargin | NSViewMinYMargin | NSViewMaxYMargin];
     [progressIndicator setUsesThreadedAnimation:TRUE];
     [progressIndicator startAnimation:self];
     
-    // Run lsof asynchronously in the background, so interface doesn't lock up
-    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
-        @autoreleasepool {
-            NSInteger fileCount;
-            LsofTask *task = [LsofTask new];
-            NSMutableArray<Item *> *items = [task launch:self->authRef numFiles:&fileCount];
-
-            // Update UI on main thread once task is done
-            dispatch_async(dispatch_get_main_queue(), ^{
-                self.unfilteredContent = items;
-                self.totalFileCount = fileCount;
-                self->isRefreshing = NO;
-                // Re-enable controls
-                [self->progressIndicator stopAnimation:self];
-                [self->outlineView setEnabled:YES];
-                [self->outlineView setAlphaValue:1.0];
-                [self->refreshButton setEnabled:YES];
-                [self->authenticateButton setEnabled:YES];
-                // Filter results
-                [self updateFiltering];
-            });
+    id<SnapshotBackend> backend = [SnapshotBackends backendFromDefaults:authRef];
+    LsofQuery *query = [LsofQuery fullScan];
+    if ([backend isKindOfClass:[LsofTask class]]) {
+        query = [self queryForFilters];
+        [(LsofTask *)backend setQuery:query];
+    }
+    refreshQuery = query;
+    
+    [refreshPipeline refreshWithBackend:backend
+                                authRef:authRef
+                           fromSnapshot:self.snapshot
+                             completion:^(Snapshot *snapshot, NSMutableArray<Item *> *items, SnapshotDiff *diff) {
+        [self finishRefreshWithSnapshot:snapshot items:items diff:diff query:query];
+    }];
+}
+
+// List only the processes with the given PIDs again, e.g. after
+// acting on one of them, rather than rescanning the whole system
+- (void)refreshProcesses:(NSIndexSet *)pids {
+    [processesToRescan addIndexes:pids];
+    [self refreshChangedProcesses];
+}
+
+// Merge a listing of only the processes that have changed into the
+// current snapshot. Waits for any refresh in progress to finish.
+- (void)refreshChangedProcesses {
+    Snapshot *snapshot = self.snapshot;
+    if ([refreshPipeline isRunning] || snapshot == nil) {
+        return;
+    }
+    
+    // Only processes in the snapshot can be removed
+    NSMutableIndexSet *exited = [NSMutableIndexSet indexSet];
+    for (NSUInteger i = 0; i < [snapshot processCount]; i++) {
+        if ([exitedProcesses containsIndex:snapshot.processes[i].pid]) {
+            [exited addIndex:snapshot.processes[i].pid];
         }
+    }
+    NSIndexSet *rescan = [processesToRescan copy];
+    [exitedProcesses removeAllIndexes];
+    [processesToRescan removeAllIndexes];
+    if ([exited count] == 0 && [rescan count] == 0) {
+        return;
+    }
+    if ([rescan count] > MAX_PROCESS_RESCAN) {
+        [self refresh:self];
+        return;
+    }
+    
+    LsofQuery *query = snapshotQuery ? snapshotQuery : [LsofQuery fullScan];
+    LsofTask *backend = nil;
+    if ([rescan count]) {
+        // Other backends can't list single processes
+        if ([[SnapshotBackends backendFromDefaults:authRef] isKindOfClass:[LsofTask class]] == NO) {
+            [self refresh:self];
+            return;
+        }
+        backend = [LsofTask new];
+        backend.query = [query queryRestrictedToPIDs:rescan];
+    }
+    NSMutableIndexSet *pids = [exited mutableCopy];
+    [pids addIndexes:rescan];
+    
+    [refreshPipeline refreshProcesses:pids
+                           ofSnapshot:snapshot
+                          withBackend:backend
+                              authRef:authRef
+                           completion:^(Snapshot *merged, NSMutableArray<Item *> *items, SnapshotDiff *diff) {
+        [self finishRefreshWithSnapshot:merged items:items diff:diff query:query];
+    }];
+}
+
+// Snapshot is nil if the refresh failed, in which
+// case the current snapshot stays on display
+- (void)finishRefreshWithSnapshot:(Snapshot * _Nullable)snapshot
+                            items:(NSMutableArray<Item *> * _Nullable)items
+                             diff:(SnapshotDiff * _Nullable)diff
+                            query:(LsofQuery *)query {
+    [progressIndicator stopAnimation:self];
+    [authenticateButton setEnabled:YES];
+    refreshQuery = nil;
+    if (snapshot && items) {
+        [self setSnapshot:snapshot items:items diff:diff query:query];
+        [self updateFiltering];
+    } else if (self.snapshot == nil) {
+        [numItemsTextField setStringValue:@"Failed to list open files"];
+    }
+    
+    if (refreshPending) {
+        [self refresh:self];
+    } else {
+        [self refreshChangedProcesses];
+    }
+}
+
+- (void)setSnapshot:(Snapshot *)snapshot
+              items:(NSMutableArray<Item *> *)items
+               diff:(SnapshotDiff * _Nullable)diff
+              query:(LsofQuery *)query {
+    self.snapshot = snapshot;
+    snapshotQuery = query;
+    self.unfilteredContent = items;
+    self.totalFileCount = [snapshot fileCount];
+    pendingDiff = diff;
+    
+    // Index names for search in the background
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        [[TrigramIndex sharedIndex] indexSnapshot:snapshot];
     });
+    
+    [self watchProcessesInSnapshot:snapshot];
+}
+
+- (void)watchProcessesInSnapshot:(Snapshot *)snapshot {
+    if (processWatcher == nil) {
+        return;
+    }
+    NSMutableIndexSet *pids = [NSMutableIndexSet indexSet];
+    for (NSUInteger i = 0; i < [snapshot processCount]; i++) {
+        [pids addIndex:snapshot.processes[i].pid];
+    }
+    [processWatcher watchProcesses:pids];
+}
+
+- (void)setProcessWatcherEnabled:(BOOL)enabled {
+    if (enabled == (processWatcher != nil)) {
+        return;
+    }
+    [processWatcher stop];
+    processWatcher = nil;
+    [exitedProcesses removeAllIndexes];
+    [processesToRescan removeAllIndexes];
+    if (!enabled) {
+        return;
+    }
+    
+    __block __weak ProcessWatcher *weakWatcher = nil;
+    ProcessWatcher *watcher = [[ProcessWatcher alloc] initWithHandler:^(NSIndexSet *exited, NSIndexSet *started, NSIndexSet *execed) {
+        if (self->processWatcher == nil || self->processWatcher != weakWatcher) {
+            return;
+        }
+        // Exec'd processes have a new name, path and icon
+        [[ProcessInfoCache sharedCache] evictProcesses:execed];
+        [self->exitedProcesses addIndexes:exited];
+        // Other backends can only list all processes, so new and exec'd
+        // processes are left to the periodic refresh rather than
+        // rescanning everything whenever a process starts
+        if ([[SnapshotBackends backendFromDefaults:self->authRef] isKindOfClass:[LsofTask class]]) {
+            [self->processesToRescan addIndexes:started];
+            [self->processesToRescan addIndexes:execed];
+        }
+        [self->processesToRescan removeIndexes:exited];
+        [self refreshChangedProcesses];
+    }];
+    weakWatcher = watcher;
+    processWatcher = watcher;
+    
+    if (self.snapshot) {
+        [self watchProcessesInSnapshot:self.snapshot];
+    }
 }
 
-- (void)setUpdateTimerFromDefaults {
+// Periodic updates are done by a single lsof running in repeat mode,
+// rather than launching a new lsof process for each update.
+- (void)setUpdateSessionFromDefaults {
+    if (updateSession) {
+        [updateSession stop];
+        updateSession = nil;
+    }
     if (updateTimer) {
         [updateTimer invalidate];
         updateTimer = nil;
     }
     NSInteger secInterval = [DEFAULTS integerForKey:@"updateInterval"];
+    
+    // Only lsof and libproc backends list live processes
+    id<SnapshotBackend> backend = [SnapshotBackends backendFromDefaults:authRef];
+    BOOL isLive = ([backend isKindOfClass:[LsofTask class]] || [backend isKindOfClass:[NativeTask class]]);
+    [self setProcessWatcherEnabled:(secInterval > 0 && isLive && [DEFAULTS boolForKey:@"processEvents"])];
+    
     if (secInterval == 0) { // Manual updates only
         return;
     }
-    updateTimer = [NSTimer scheduledTimerWithTimeInterval:secInterval
-                                                   target:self
-                                                 selector:@selector(refresh:)
-                                                 userInfo:nil
-                                                  repeats:YES];
+    
+    // Only lsof has a repeat mode, other backends are refreshed periodically
+    if ([backend isKindOfClass:[LsofTask class]] == NO) {
+        updateTimer = [NSTimer scheduledTimerWithTimeInterval:secInterval
+                                                       target:self
+                                                     selector:@selector(refresh:)
+                                                     userInfo:nil
+                                                      repeats:YES];
+        return;
+    }
+    
+    LsofTask *session = [LsofTask new];
+    session.query = [self queryForFilters];
+    updateSession = session;
+    [session startRepeating:authRef interval:secInterval handler:^(Snapshot *snapshot) {
+        NSMutableArray<Item *> *items = [Item itemsForSnapshot:snapshot];
+        __block Snapshot *previous;
+        dispatch_sync(dispatch_get_main_queue(), ^{
+            previous = self.snapshot;
+        });
+        SnapshotDiff *diff = previous ? [SnapshotDiff diffFromSnapshot:previous toSnapshot:snapshot] : nil;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            // Ignore output from a replaced session or during manual refresh
+            if (self->updateSession != session || [self->refreshPipeline isRunning]) {
+                return;
+            }
+            [self setSnapshot:snapshot items:items diff:diff query:session.query];
+            [self updateFiltering];
+        });
+    }];
 }
 
 #pragma mark - Filtering
@@ -316,31 +542,200 @@
 }
 
 - (void)updateFiltering {
-    if (isRefreshing) {
+    // lsof only lists what the filters at the time of the refresh could
+    // show, so fetch again if the filters have been widened since then
+    LsofQuery *query = [self queryForFilters];
+    if (updateSession) {
+        if (![updateSession.query isEqual:query]) {
+            [self setUpdateSessionFromDefaults];
+        }
+    } else if (snapshotQuery && ![snapshotQuery covers:query]) {
+        // Unless the refresh in progress will do
+        if (!([refreshPipeline isRunning] && [refreshQuery covers:query])) {
+            [self refresh:self];
+        }
         return;
     }
     
-    // Filter content
-    NSInteger matchingFilesCount = 0;
-    self.content = [self filterContent:self.unfilteredContent numberOfMatchingFiles:&matchingFilesCount];
+    // Filter content in the background. Results for a snapshot that
+    // has since been replaced are dropped.
+    Snapshot *snapshot = self.snapshot;
+    [filterEngine filterContent:self.unfilteredContent
+                     ofSnapshot:snapshot
+                   withSettings:[self filterSettings]
+                     completion:^(NSMutableArray<Item *> *filteredContent, NSInteger matchingFilesCount) {
+        if (self.snapshot != snapshot) {
+            return;
+        }
+        [self showFilteredContent:filteredContent matchingFilesCount:matchingFilesCount];
+    }];
+}
+
+- (void)showFilteredContent:(NSMutableArray<Item *> *)filteredContent matchingFilesCount:(NSInteger)matchingFilesCount {
+    // After a refresh, update shown items in place if possible
+    BOOL incremental = (pendingDiff && pendingDiff.oldSnapshot == displayedSnapshot && self.content);
+    if (incremental) {
+        [self applyContent:filteredContent diff:pendingDiff];
+        // Items shown have been rebound to the new snapshot
+        [infoPanelController reloadItem];
+    } else {
+        self.content = [sorter sortedItems:filteredContent ascending:sortedAscending];
+    }
+    pendingDiff = nil;
+    displayedSnapshot = self.snapshot;
     
     // Update outline view header
     [self updateProcessCountHeader];
     
     // Update num items label
     NSString *str = [NSString stringWithFormat:@"Showing %ld out of %ld items", (long)matchingFilesCount, (long)self.totalFileCount];
-    if (matchingFilesCount == self.totalFileCount) {
+    if (snapshotQuery && !snapshotQuery.isFullScan) {
+        str = [NSString stringWithFormat:@"Showing %ld items", (long)matchingFilesCount];
+    } else if (matchingFilesCount == self.totalFileCount) {
         str = [NSString stringWithFormat:@"Showing all %ld items", (long)self.totalFileCount];
     }
     [numItemsTextField setStringValue:str];
     
-    [outlineView reloadData];
+    if (incremental) {
+        return;
+    }
     
-    if ([DEFAULTS boolForKey:@"disclosure"]) {
-        [outlineView expandItem:nil expandChildren:YES];
-    } else {
-        [outlineView collapseItem:nil collapseChildren:YES];
+    [self reloadOutlineView];
+}
+
+#pragma mark - Incremental updates
+
+// Update the shown items in place to match content filtered from a newer
+// snapshot. The tree controller observes these changes, so only rows that
+// were added, removed or changed are updated, and selection and expansion
+// state is preserved.
+- (void)applyContent:(NSMutableArray<Item *> *)newContent diff:(SnapshotDiff *)diff {
+    // Shown processes by their index in the old snapshot
+    NSMutableDictionary<NSNumber*, Item*> *oldProcesses = [NSMutableDictionary dictionaryWithCapacity:[self.content count]];
+    for (Item *p in self.content) {
+        oldProcesses[@(p.index)] = p;
+    }
+    
+    NSMutableArray<Item *> *addedProcesses = [NSMutableArray new];
+    NSMutableArray<Item *> *keptProcesses = [NSMutableArray new];
+    NSMutableArray<Item *> *updatedProcesses = [NSMutableArray new];
+    for (Item *newProcess in newContent) {
+        NSUInteger oldIndex = [diff oldIndexForProcess:newProcess.index];
+        Item *oldProcess = (oldIndex == NSNotFound) ? nil : oldProcesses[@(oldIndex)];
+        if (oldProcess == nil) {
+            [addedProcesses addObject:newProcess];
+            continue;
+        }
+        [oldProcesses removeObjectForKey:@(oldIndex)];
+        [keptProcesses addObject:oldProcess];
+        [updatedProcesses addObject:newProcess];
+    }
+    
+    // Remove processes no longer shown
+    NSSet<Item *> *removed = [NSSet setWithArray:[oldProcesses allValues]];
+    NSIndexSet *removedIndexes = [self.content indexesOfObjectsPassingTest:^BOOL(Item *p, NSUInteger idx, BOOL *stop) {
+        return [removed containsObject:p];
+    }];
+    if ([removedIndexes count]) {
+        [self removeContentAtIndexes:removedIndexes];
+    }
+    
+    // Update processes still shown
+    for (NSUInteger i = 0; i < [keptProcesses count]; i++) {
+        [self updateProcessItem:keptProcesses[i] fromItem:updatedProcesses[i] diff:diff];
+    }
+    
+    // Processes whose sort key changed, e.g. their file count or their
+    // name after an exec, are moved back into sort order with the new ones
+    NSIndexSet *movedIndexes = [sorter indexesOfItemsOutOfOrder:self.content ascending:sortedAscending];
+    if ([movedIndexes count]) {
+        NSArray<Item *> *moved = [self.content objectsAtIndexes:movedIndexes];
+        [self removeContentAtIndexes:movedIndexes];
+        for (Item *p in moved) {
+            NSUInteger index = [sorter insertionIndexForItem:p inItems:self.content ascending:sortedAscending];
+            [self insertContent:@[p] atIndexes:[NSIndexSet indexSetWithIndex:index]];
+        }
+        applyingExpansion = YES;
+        for (Item *p in moved) {
+            if ([self isProcessExpanded:p]) {
+                [outlineView expandItem:p];
+            }
+        }
+        applyingExpansion = NO;
+    }
+    
+    // Add new processes where they belong in the sort order
+    if ([addedProcesses count]) {
+        for (Item *p in addedProcesses) {
+            NSUInteger index = [sorter insertionIndexForItem:p inItems:self.content ascending:sortedAscending];
+            [self insertContent:@[p] atIndexes:[NSIndexSet indexSetWithIndex:index]];
+        }
+        
+        applyingExpansion = YES;
+        for (Item *p in addedProcesses) {
+            if ([self isProcessExpanded:p]) {
+                [outlineView expandItem:p];
+            }
+        }
+        applyingExpansion = NO;
+    }
+}
+
+- (void)updateProcessItem:(Item *)process fromItem:(Item *)newProcess diff:(SnapshotDiff *)diff {
+    // Children of a collapsed process aren't shown, so there is no need
+    // to create and compare them
+    if (![outlineView isItemExpanded:process]) {
+        [process adoptChildrenOfItem:newProcess];
+        [process rebindToSnapshot:diff.snapshot index:newProcess.index changed:NO];
+        [outlineView reloadItem:process];
+        return;
+    }
+    
+    NSMutableDictionary<NSNumber*, Item*> *oldFiles = [NSMutableDictionary dictionaryWithCapacity:[process.children count]];
+    for (Item *f in process.children) {
+        oldFiles[@(f.index)] = f;
+    }
+    
+    NSMutableArray<Item *> *addedFiles = [NSMutableArray new];
+    for (Item *newFile in newProcess.children) {
+        NSUInteger oldIndex = [diff oldIndexForFile:newFile.index];
+        Item *oldFile = (oldIndex == NSNotFound) ? nil : oldFiles[@(oldIndex)];
+        if (oldFile == nil) {
+            [addedFiles addObject:newFile];
+            continue;
+        }
+        [oldFiles removeObjectForKey:@(oldIndex)];
+        [oldFile rebindToSnapshot:diff.snapshot index:newFile.index changed:[diff fileChanged:newFile.index]];
     }
+    
+    NSSet<Item *> *removed = [NSSet setWithArray:[oldFiles allValues]];
+    NSIndexSet *removedIndexes = [process.children indexesOfObjectsPassingTest:^BOOL(Item *f, NSUInteger idx, BOOL *stop) {
+        return [removed containsObject:f];
+    }];
+    if ([removedIndexes count]) {
+        [process removeChildrenAtIndexes:removedIndexes];
+        [outlineView removeItemsAtIndexes:removedIndexes inParent:process withAnimation:NSTableViewAnimationEffectNone];
+    }
+    
+    [process rebindToSnapshot:diff.snapshot index:newProcess.index changed:NO];
+    
+    if ([addedFiles count]) {
+        NSRange range = NSMakeRange([process.children count], [addedFiles count]);
+        NSIndexSet *indexes = [NSIndexSet indexSetWithIndexesInRange:range];
+        [process insertChildren:addedFiles atIndexes:indexes];
+        [outlineView insertItemsAtIndexes:indexes inParent:process withAnimation:NSTableViewAnimationEffectNone];
+    }
+}
+
+// Mutation of content, mirrored in the outline view
+- (void)insertContent:(NSArray<Item *> *)items atIndexes:(NSIndexSet *)indexes {
+    [_content insertObjects:items atIndexes:indexes];
+    [outlineView insertItemsAtIndexes:indexes inParent:nil withAnimation:NSTableViewAnimationEffectNone];
+}
+
+- (void)removeContentAtIndexes:(NSIndexSet *)indexes {
+    [_content removeObjectsAtIndexes:indexes];
+    [outlineView removeItemsAtIndexes:indexes inParent:nil withAnimation:NSTableViewAnimationEffectNone];
 }
 
 // User typed in search filter
@@ -366,11 +761,11 @@
                         change:(NSDictionary *)change
                        context:(void *)context {
     if ([VALUES_KEYPATH(@"interfaceSize") isEqualToString:keyPath]) {
-        [outlineView reloadData];
+        [self updateRowHeight];
         return;
     }
     if ([VALUES_KEYPATH(@"updateInterval") isEqualToString:keyPath]) {
-        [self setUpdateTimerFromDefaults];
+        [self setUpdateSessionFromDefaults];
         return;
     }
     if ([VALUES_KEYPATH(@"showPathBar") isEqualToString:keyPath]) {
@@ -381,258 +776,30 @@
     [self updateFiltering];
 }
 
-// Filter content according to active filters
-- (NSMutableArray<Item *> *)filterContent:(NSMutableArray<Item *> *)unfilteredContent
-                    numberOfMatchingFiles:(NSInteger *)matchingFilesCount {
-    BOOL showRegularFiles = [DEFAULTS boolForKey:@"showRegularFiles"];
-    BOOL showDirectories = [DEFAULTS boolForKey:@"showDirectories"];
-    BOOL showIPSockets = [DEFAULTS boolForKey:@"showIPSockets"];
-    BOOL showUnixSockets = [DEFAULTS boolForKey:@"showUnixSockets"];
-    BOOL showCharDevices = [DEFAULTS boolForKey:@"showCharacterDevices"];
-    BOOL showPipes = [DEFAULTS boolForKey:@"showPipes"];
-    
-    BOOL showApplicationsOnly = [DEFAULTS boolForKey:@"showApplicationsOnly"];
-    BOOL showHomeFolderOnly = [DEFAULTS boolForKey:@"showHomeFolderOnly"];
-    
-    BOOL searchCaseSensitive = [DEFAULTS boolForKey:@"searchFilterCaseSensitive"];
-    BOOL searchUsesRegex = [DEFAULTS boolForKey:@"searchFilterRegex"];
-    
-    // Access mode filter
-    NSString *accessModeFilter = [DEFAULTS stringForKey:@"accessMode"];
-    BOOL hasAccessModeFilter = ([accessModeFilter isEqualToString:@"Any"] == NO);
-    
-    // Volumes filter
-    NSNumber *volumesFilter = nil; // Device ID number
-    BOOL hasVolumesFilter = ([[[volumesPopupButton selectedItem] title] isEqualToString:@"All"] == NO);
-    if (hasVolumesFilter) {
-        volumesFilter = [[volumesPopupButton selectedItem] representedObject][@"devid"];
-    }
-    
-    // Path filters such as by volume or home folder should
-    // exclude everything that isn't a file or directory
-    if (hasVolumesFilter || showHomeFolderOnly) {
-        showIPSockets = NO;
-        showUnixSockets = NO;
-        showCharDevices = NO;
-        showPipes = NO;
-    }
-    
-    // User home dir path prefix
-    NSString *homeDirPath = NSHomeDirectory();
-    
-    // Search field filter, precompile regexes
-    NSMutableArray *searchFilters = [NSMutableArray new];
-    NSString *fieldString = [[filterTextField stringValue] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
-    NSArray<NSString*> *filterStrings = [fieldString componentsSeparatedByString:@" "];
-    // Trim and create regex objects from search filter strings
-    for (NSString *fs in filterStrings) {
-        NSString *s = [fs stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
-        if ([s length] == 0) {
-            continue;
-        }
-        
-        if (searchUsesRegex) {
-            NSError *err;
-            NSRegularExpressionOptions options = searchCaseSensitive ? 0 : NSRegularExpressionCaseInsensitive;
-            NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:s
-                                                                                   options:options
-                                                                                     error:&err];
-            if (!regex) {
-                DLog(@"Error creating search filter regex: %@", [err localizedDescription]);
-                continue;
-            }
-            [searchFilters addObject:regex];
-        } else {
-            [searchFilters addObject:s];
-        }
-    }
-    
-    // Filters set in Settings, precompile regexes
-    NSMutableArray *settingsFilters = [NSMutableArray new];
-    NSArray *pfStrings = [DEFAULTS objectForKey:@"filters"];
-    for (NSArray *ps in pfStrings) {
-        if ([ps[0] boolValue] == NO) {
-            continue;
-        }
-        NSString *s = [ps[1] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
-        if ([s length] == 0) {
-            continue;
-        }
-        NSError *err;
-        NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:s
-                                                                               options:0
-                                                                                 error:&err];
-        if (!regex) {
-            DLog(@"Error creating settings filter regex: %@", [err localizedDescription]);
-            continue;
-        }
-        [settingsFilters addObject:regex];
-        DLog(@"Adding regex: %@", ps[1]);
-    }
-    
-    BOOL hasSearchFilter = ([searchFilters count] > 0);
-    BOOL hasSettingsFilter = ([settingsFilters count] > 0);
-    BOOL showAllProcessTypes = !showApplicationsOnly;
-    BOOL showAllItemTypes = (showRegularFiles &&
-                             showDirectories &&
-                             showIPSockets &&
-                             showUnixSockets &&
-                             showCharDevices &&
-                             showPipes &&
-                             !showHomeFolderOnly &&
-                             !hasVolumesFilter);
-    
-    // Minor optimization: If there is no filtering, just return
-    // unfiltered content instead of iterating over all items
-    if (showAllItemTypes && showAllProcessTypes && !hasSearchFilter && !hasSettingsFilter && !hasAccessModeFilter) {
-        *matchingFilesCount = self.totalFileCount;
-        return unfilteredContent;
-    }
-    
-    NSMutableArray<Item *> *filteredContent = [NSMutableArray array];
-    
-    // Iterate over each process, filter the children
-    for (Item *process in unfilteredContent) {
-        
-        NSMutableArray<Item*> *matchingFiles = [NSMutableArray array];
-        
-        for (Item *file in process[@"children"]) {
-            
-            // Let's see if child gets filtered by type or path
-            if (showAllItemTypes == NO) {
-                
-                if (showHomeFolderOnly && ![file[@"name"] hasPrefix:homeDirPath]) {
-                    continue;
-                }
-                
-                if (volumesFilter) {
-//                    DLog(@"%@ cmp %@", file[@"device"][@"devid"], volumesFilter);
-                    if ([file[@"device"][@"devid"] isEqualToNumber:volumesFilter] == NO) {
-                        continue;
-                    }
-                }
-                
-                NSString *type = file[@"type"];
-                if (([type hasPrefix:@"F"] && !showRegularFiles) ||
-                    ([type hasPrefix:@"D"] && !showDirectories) ||
-                    ([type hasPrefix:@"I"] && !showIPSockets) ||
-                    ([type hasPrefix:@"U"] && !showUnixSockets) ||
-                    ([type hasPrefix:@"C"] && !showCharDevices) ||
-                    ([type hasPrefix:@"P"] && !showPipes)) {
-                    continue;
-                }
-            }
-            
-            // Filter by access mode
-            if (hasAccessModeFilter) {
-                NSString *mode = file[@"accessmode"];
-                if ([accessModeFilter isEqualToString:@"Read"] && ![mode isEqualToString:@"r"]) {
-                    continue;
-                }
-                if ([accessModeFilter isEqualToString:@"Write"] && ![mode isEqualToString:@"w"]) {
-                    continue;
-                }
-                if ([accessModeFilter isEqualToString:@"Read/Write"] && ![mode isEqualToString:@"u"]) {
-                    continue;
-                }
-            }
-            
-            // See if it matches regexes in search field filter
-            if (hasSearchFilter) {
-                
-                NSInteger matchCount = 0;
-                
-                if (searchUsesRegex) {
-                    
-                    // Regex search
-                    for (NSRegularExpression *regex in searchFilters) {
-                        if (!([file[@"name"] isMatchedByRegex:regex] ||
-                              [file[@"pname"] isMatchedByRegex:regex] ||
-                              [file[@"pid"] isMatchedByRegex:regex] ||
-                              [file[@"protocol"] isMatchedByRegex:regex] ||
-                              [file[@"ipversion"] isMatchedByRegex:regex] ||
-                              [file[@"socketstate"] isMatchedByRegex:regex])) {
-                            break;
-                        }
-                        matchCount += 1;
-                    }
-                    
-                } else {
-                    
-                    // Non-regex search
-                    NSStringCompareOptions options = searchCaseSensitive ? 0 : NSCaseInsensitiveSearch;
-                    
-                    for (NSString *searchStr in searchFilters) {
-                        if ([file[@"name"] rangeOfString:searchStr options:options].location == NSNotFound &&
-                            [file[@"pname"] rangeOfString:searchStr options:options].location == NSNotFound &&
-                            [file[@"pid"] rangeOfString:searchStr options:options].location == NSNotFound) {
-                            break;
-                        }
-                        matchCount += 1;
-                    }
-                }
-                
-                // Skip if it doesn't match all filter strings
-                if (matchCount != [searchFilters count]) {
-                    continue;
-                }
-            }
-            
-            // Settings filters only filter by name
-            if (hasSettingsFilter) {
-                // Skip any file w. name matching
-                BOOL skip = NO;
-                for (NSRegularExpression *regex in settingsFilters) {
-                    if ([file[@"name"] isMatchedByRegex:regex]) {
-                        skip = YES;
-                    }
-                }
-                if (skip) {
-                    continue;
-                }
-            }
-            
-            [matchingFiles addObject:file];
-        }
-        
-        // If we have matching files for the process, and it's not being excluded as a non-app
-        if ([matchingFiles count] && !(showApplicationsOnly && ![process[@"app"] boolValue])) {
-            Item *p = [[Item alloc] init];
-            [p addEntriesFromDictionary:process];
-            p[@"children"] = matchingFiles;
-            // Num files shown in brackets after name needs to be updated
-            [LsofTask updateProcessInfo:p];
-            [filteredContent addObject:p];
-            *matchingFilesCount += [matchingFiles count];
-        }
+// Query that lets lsof skip files the active filters would exclude
+- (LsofQuery *)queryForFilters {
+    NSString *mountPoint = nil;
+    if ([[[volumesPopupButton selectedItem] title] isEqualToString:@"All"] == NO) {
+        mountPoint = [[volumesPopupButton selectedItem] representedObject][@"mountpoint"];
     }
-    
-    return filteredContent;
+    return [LsofQuery queryForFiltersWithMountPoint:mountPoint];
 }
 
-- (IBAction)showAll:(id)sender {
-    [DEFAULTS setObject:@YES forKey:@"showRegularFiles"];
-    [DEFAULTS setObject:@YES forKey:@"showDirectories"];
-    [DEFAULTS setObject:@YES forKey:@"showCharacterDevices"];
-    [DEFAULTS setObject:@YES forKey:@"showIPSockets"];
-    [DEFAULTS setObject:@YES forKey:@"showPipes"];
-    [DEFAULTS setObject:@YES forKey:@"showUnixSockets"];
-    
-    [DEFAULTS setObject:@NO forKey:@"showApplicationsOnly"];
-    [DEFAULTS setObject:@NO forKey:@"showHomeFolderOnly"];
-    
-    [DEFAULTS setObject:@"Any" forKey:@"accessMode"];
-    [filterTextField setStringValue:@""];
-    [volumesPopupButton selectItemAtIndex:0];
-    
-    [self updateFiltering];
+// Active filters, read from defaults and the interface
+- (FilterSettings *)filterSettings {
+    NSNumber *volumeDevice = nil;
+    if ([[[volumesPopupButton selectedItem] title] isEqualToString:@"All"] == NO) {
+        volumeDevice = [[volumesPopupButton selectedItem] representedObject][@"devid"];
+    }
+    return [FilterSettings settingsFromDefaultsWithVolume:volumeDevice
+                                             searchString:[filterTextField stringValue]];
 }
 
 #pragma mark - Interface actions
 
 - (IBAction)open:(id)sender {
     NSInteger selectedRow = ([outlineView clickedRow] == -1) ? [outlineView selectedRow] : [outlineView clickedRow];
-    NSDictionary *item = [[outlineView itemAtRow:selectedRow] representedObject];
+    Item *item = [outlineView itemAtRow:selectedRow];
     NSString *path = item[@"name"];
     
     if ([WORKSPACE canRevealFileAtPath:path] == NO || [WORKSPACE openFile:path] == NO) {
@@ -642,7 +809,7 @@
 
 - (IBAction)kill:(id)sender {
     NSInteger selectedRow = ([outlineView clickedRow] == -1) ? [outlineView selectedRow] : [outlineView clickedRow];
-    NSDictionary *item = [[outlineView itemAtRow:selectedRow] representedObject];
+    Item *item = [outlineView itemAtRow:selectedRow];
     
     if (item[@"pid"] == nil) {
         NSBeep();
@@ -675,25 +842,54 @@
         return;
     }
     
-    [self refresh:self];
+    [self refreshKilledProcess:pid];
+}
+
+// Remove a killed process once it has exited. A process that
+// handles the signal and keeps running is listed again instead.
+- (void)refreshKilledProcess:(pid_t)pid {
+    dispatch_source_t exitSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_PROC, pid, DISPATCH_PROC_EXIT,
+                                                          dispatch_get_main_queue());
+    __block BOOL done = NO;
+    void (^update)(void) = ^{
+        if (done) {
+            return;
+        }
+        done = YES;
+        if (exitSource) {
+            dispatch_source_cancel(exitSource);
+        }
+        if (kill(pid, 0) == -1 && errno == ESRCH) {
+            [self->exitedProcesses addIndex:pid];
+            [self refreshChangedProcesses];
+        } else {
+            [self refreshProcesses:[NSIndexSet indexSetWithIndex:pid]];
+        }
+    };
+    if (exitSource) {
+        dispatch_source_set_event_handler(exitSource, update);
+        dispatch_resume(exitSource);
+    }
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(KILL_EXIT_TIMEOUT * NSEC_PER_SEC)),
+                   dispatch_get_main_queue(), update);
 }
 
 - (IBAction)show:(id)sender {
     NSInteger selectedRow = [outlineView clickedRow] == -1 ? [outlineView selectedRow] : [outlineView clickedRow];
-    NSDictionary *item = [[outlineView itemAtRow:selectedRow] representedObject];
+    Item *item = [outlineView itemAtRow:selectedRow];
     [self revealItemInFinder:item];
 }
 
 - (IBAction)showInfoInFinder:(id)sender {
     NSInteger selectedRow = [outlineView clickedRow] == -1 ? [outlineView selectedRow] : [outlineView clickedRow];
-    NSDictionary *item = [[outlineView itemAtRow:selectedRow] representedObject];
+    Item *item = [outlineView itemAtRow:selectedRow];
     NSString *path = item[@"path"] ? item[@"path"] : item[@"name"];
     [WORKSPACE showFinderGetInfoForFile:path];
 }
 
 - (IBAction)showPackageContents:(id)sender {
     NSInteger selectedRow = [outlineView clickedRow] == -1 ? [outlineView selectedRow] : [outlineView clickedRow];
-    NSDictionary *item = [[outlineView itemAtRow:selectedRow] representedObject];
+    Item *item = [outlineView itemAtRow:selectedRow];
     NSString *path = item[@"path"] ? item[@"path"] : item[@"name"];
     if (![WORKSPACE showPackageContents:path]) {
         NSBeep();
@@ -702,7 +898,7 @@
 
 - (IBAction)moveToTrash:(id)sender {
     NSInteger selectedRow = [outlineView clickedRow] == -1 ? [outlineView selectedRow] : [outlineView clickedRow];
-    NSDictionary *item = [[outlineView itemAtRow:selectedRow] representedObject];
+    Item *item = [outlineView itemAtRow:selectedRow];
     NSString *path = item[@"path"] ? item[@"path"] : item[@"name"];
     
     BOOL optionKeyDown = (([[NSApp currentEvent] modifierFlags] & NSEventModifierFlagOption) == NSEventModifierFlagOption);
@@ -726,7 +922,7 @@
 - (IBAction)getInfo:(id)sender {
     NSInteger selectedRow = [outlineView selectedRow];
     if (selectedRow >= 0) {
-        [self showInfoPanelForItem:[[outlineView itemAtRow:selectedRow] representedObject]];
+        [self showInfoPanelForItem:[outlineView itemAtRow:selectedRow]];
     } else {
         NSBeep();
     }
@@ -739,6 +935,11 @@
     }
     [infoPanelController loadItem:item];
     [infoPanelController showWindow:self];
+    
+    // Make sure the panel shows the process's current files
+    if (item[@"pid"]) {
+        [self refreshProcesses:[NSIndexSet indexSetWithIndex:(NSUInteger)[item process]->pid]];
+    }
 }
 
 // Called when user selects Copy menu item via Edit or contextual menu
@@ -758,7 +959,7 @@
     
     // Find which items are filenames
     [[outlineView selectedRowIndexes] enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
-        NSDictionary *item = [[outlineView itemAtRow:idx] representedObject];
+        Item *item = [outlineView itemAtRow:idx];
         if ([FILEMGR fileExistsAtPath:item[@"name"]]) {
             [filePaths addObject:item[@"name"]];
         }
@@ -789,7 +990,7 @@
 
 - (void)rowDoubleClicked:(id)object {
     NSInteger rowNumber = [outlineView clickedRow];
-    Item *item = [[outlineView itemAtRow:rowNumber] representedObject];
+    Item *item = [outlineView itemAtRow:rowNumber];
     
     BOOL cmdKeyDown = (([[NSApp currentEvent] modifierFlags] & NSEventModifierFlagCommand) == NSEventModifierFlagCommand);
     if (cmdKeyDown) {
@@ -799,7 +1000,7 @@
     }
 }
 
-- (void)revealItemInFinder:(NSDictionary *)item {
+- (void)revealItemInFinder:(Item *)item {
     NSString *path = item[@"path"] ? item[@"path"] : item[@"name"];
     if ([WORKSPACE canRevealFileAtPath:path]) {
         if ([WORKSPACE selectFile:path inFileViewerRootedAtPath:[path stringByDeletingLastPathComponent]]) {
@@ -829,14 +1030,42 @@
 #pragma mark - Disclosure
 
 - (IBAction)disclosureChanged:(id)sender {
-    if ([DEFAULTS boolForKey:@"disclosure"]) {
-        [outlineView expandItem:nil expandChildren:YES];
+    expandAll = [DEFAULTS boolForKey:@"disclosure"];
+    [toggledProcesses removeAllObjects];
+    if (expandAll) {
+        [self applyExpansion];
     } else {
         [outlineView collapseItem:nil collapseChildren:YES];
     }
     [self updateDiscloseControl];
 }
 
+- (BOOL)isProcessExpanded:(Item *)process {
+    return expandAll != [toggledProcesses containsObject:@([process process]->pid)];
+}
+
+// Expand processes one by one. Files have no children,
+// so there is no need to walk the whole tree.
+- (void)applyExpansion {
+    applyingExpansion = YES;
+    for (Item *p in self.content) {
+        if ([self isProcessExpanded:p]) {
+            [outlineView expandItem:p];
+        }
+    }
+    applyingExpansion = NO;
+}
+
+- (void)reloadOutlineView {
+    [outlineView reloadData];
+    [self applyExpansion];
+}
+
+- (void)updateRowHeight {
+    NSString *size = [DEFAULTS stringForKey:@"interfaceSize"];
+    [outlineView setRowHeight:[size isEqualToString:@"Compact"] ? 16.f : 20.f];
+}
+
 - (void)updateDiscloseControl {
     if ([DEFAULTS boolForKey:@"disclosure"]) {
         [disclosureTextField setStringValue:@"Collapse all"];
@@ -858,88 +1087,31 @@
 }
 
 - (void)updateSorting {
-    NSString *sortBy = [DEFAULTS objectForKey:@"sortBy"];
-    
-    // Default to sorting alphabetically by name
-    NSSortDescriptor *sortDesc = [[NSSortDescriptor alloc] initWithKey:@"pname"
-                                                             ascending:[DEFAULTS boolForKey:@"ascending"]
-                                                              selector:@selector(localizedCaseInsensitiveCompare:)];
+    ProcessSortKey key = [ProcessSorter keyForSortBy:[DEFAULTS stringForKey:@"sortBy"]];
+    BOOL ascending = [DEFAULTS boolForKey:@"ascending"];
     
-    // Integer comparison for string values block
-    NSComparator integerComparisonBlock = ^(id first,id second) {
-        NSUInteger cnt1 = [first intValue];
-        NSUInteger cnt2 = [second intValue];
-        
-        if (cnt1 < cnt2) {
-            return NSOrderedAscending;
-        } else if (cnt1 > cnt2) {
-            return NSOrderedDescending;
-        } else {
-            return NSOrderedSame;
-        }
-    };
-    
-    // Number of children (i.e. file count) comparison block
-    NSComparator numChildrenComparisonBlock = ^(id first,id second) {
-        NSUInteger cnt1 = [first count];
-        NSUInteger cnt2 = [second count];
-        
-        if (cnt1 < cnt2) {
-            return NSOrderedAscending;
-        } else if (cnt1 > cnt2) {
-            return NSOrderedDescending;
-        } else {
-            return NSOrderedSame;
+    NSMutableArray<Item *> *sorted;
+    if (sorter && sorter.key == key) {
+        if (ascending == sortedAscending) {
+            return;
         }
-    };
-    
-    if ([sortBy isEqualToString:@"process id"]) {
-        sortDesc = [NSSortDescriptor sortDescriptorWithKey:@"pid"
-                                                 ascending:[DEFAULTS boolForKey:@"ascending"]
-                                                comparator:integerComparisonBlock];
-    }
-    else if ([sortBy isEqualToString:@"user id"]) {
-        sortDesc = [NSSortDescriptor sortDescriptorWithKey:@"userid"
-                                                 ascending:[DEFAULTS boolForKey:@"ascending"]
-                                                comparator:integerComparisonBlock];
-    }
-    else if ([sortBy isEqualToString:@"file count"]) {
-        sortDesc = [NSSortDescriptor sortDescriptorWithKey:@"children"
-                                                 ascending:[DEFAULTS boolForKey:@"ascending"]
-                                                comparator:numChildrenComparisonBlock];
-    }
-    else if ([sortBy isEqualToString:@"process type"]) {
-        // Process type sorting uses the "bundle" and "app" boolean properties
-        NSMutableArray<NSSortDescriptor *> *sdesc = [NSMutableArray new];
-        sortDesc = [NSSortDescriptor sortDescriptorWithKey:@"bundle"
-                                                 ascending:[DEFAULTS boolForKey:@"ascending"]
-                                                comparator:integerComparisonBlock];
-        [sdesc addObject:sortDesc];
-        sortDesc = [NSSortDescriptor sortDescriptorWithKey:@"app"
-                                                 ascending:[DEFAULTS boolForKey:@"ascending"]
-                                                comparator:integerComparisonBlock];
-        [sdesc addObject:sortDesc];
-        self.sortDescriptors = [sdesc copy]; // immutable copy
-        return;
-    }
-    else if ([sortBy isEqualToString:@"carbon psn"]) {
-        sortDesc = [NSSortDescriptor sortDescriptorWithKey:@"psn"
-                                                 ascending:[DEFAULTS boolForKey:@"ascending"]
-                                                comparator:integerComparisonBlock];
-    }
-    else if ([sortBy isEqualToString:@"bundle identifier"]) {
-        sortDesc = [[NSSortDescriptor alloc] initWithKey:@"identifier"
-                                               ascending:[DEFAULTS boolForKey:@"ascending"]
-                                                selector:@selector(caseInsensitiveCompare:)];
+        // Only the order changed
+        sorted = [[[self.content reverseObjectEnumerator] allObjects] mutableCopy];
+    } else {
+        sorter = [[ProcessSorter alloc] initWithKey:key];
+        sorted = [sorter sortedItems:self.content ascending:ascending];
     }
+    sortedAscending = ascending;
+    self.content = sorted;
     
-    self.sortDescriptors = @[sortDesc];
+    [self reloadOutlineView];
 }
 
 #pragma mark - Authentication
 
 - (IBAction)toggleAuthentication:(id)sender {
-    if (isRefreshing) {
+    // A refresh in progress may still be using the authorization
+    if ([refreshPipeline isRunning]) {
         NSBeep();
         return;
     }
@@ -972,6 +1144,10 @@
     [authenticateMenuItem setToolTip:ttip];
     
     [self refresh:self];
+    // Restart periodic updates with new privileges
+    if (updateSession || updateTimer) {
+        [self setUpdateSessionFromDefaults];
+    }
 }
 
 - (OSStatus)authenticate {
@@ -1008,8 +1184,55 @@
     authenticated = NO;
 }
 
+#pragma mark - NSOutlineViewDataSource
+
+// Views are only created for visible rows, and the files of a process
+// are only created when it is expanded
+- (NSInteger)outlineView:(NSOutlineView *)ov numberOfChildrenOfItem:(id _Nullable)item {
+    if (item == nil) {
+        return [self.content count];
+    }
+    return [(Item *)item numChildren];
+}
+
+- (id)outlineView:(NSOutlineView *)ov child:(NSInteger)index ofItem:(id _Nullable)item {
+    if (item == nil) {
+        return self.content[index];
+    }
+    return [(Item *)item children][index];
+}
+
+- (BOOL)outlineView:(NSOutlineView *)ov isItemExpandable:(id)item {
+    return [(Item *)item isProcess] && [(Item *)item numChildren] > 0;
+}
+
+// Cell views bind to properties of the item
+- (id _Nullable)outlineView:(NSOutlineView *)ov objectValueForTableColumn:(NSTableColumn * _Nullable)tableColumn byItem:(id _Nullable)item {
+    return item;
+}
+
 #pragma mark - NSOutlineViewDelegate
 
+- (void)outlineViewItemDidExpand:(NSNotification *)notification {
+    [self processExpansionChanged:notification.userInfo[@"NSObject"] expanded:YES];
+}
+
+- (void)outlineViewItemDidCollapse:(NSNotification *)notification {
+    [self processExpansionChanged:notification.userInfo[@"NSObject"] expanded:NO];
+}
+
+- (void)processExpansionChanged:(Item *)item expanded:(BOOL)expanded {
+    if (applyingExpansion || ![item isProcess]) {
+        return;
+    }
+    NSNumber *pid = @([item process]->pid);
+    if (expanded == expandAll) {
+        [toggledProcesses removeObject:pid];
+    } else {
+        [toggledProcesses addObject:pid];
+    }
+}
+
 - (void)outlineView:(NSOutlineView *)ov didClickTableColumn:(NSTableColumn *)tableColumn {
     [DEFAULTS setBool:![DEFAULTS boolForKey:@"ascending"] forKey:@"ascending"];
     [self updateSorting];
@@ -1019,7 +1242,7 @@
     NSInteger selectedRow = [outlineView selectedRow];
     
     if (selectedRow >= 0) {
-        Item *item = [[outlineView itemAtRow:selectedRow] representedObject];
+        Item *item = [outlineView itemAtRow:selectedRow];
         BOOL canReveal = [WORKSPACE canRevealFileAtPath:item[@"name"]];
         BOOL hasBundlePath = [WORKSPACE canRevealFileAtPath:item[@"path"]];
         [revealButton setEnabled:(canReveal || hasBundlePath)];
@@ -1044,15 +1267,10 @@
     [self updatePathControl];
 }
 
-- (CGFloat)outlineView:(NSOutlineView *)outlineView heightOfRowByItem:(id)item {
-    NSString *size = [DEFAULTS stringForKey:@"interfaceSize"];
-    return [size isEqualToString:@"Compact"] ? 16.f : 20.f;
-}
-
 - (BOOL)outlineView:(NSOutlineView *)outlineView
          writeItems:(NSArray *)items
        toPasteboard:(NSPasteboard *)pboard {
-    NSDictionary *item = [items[0] representedObject];
+    Item *item = items[0];
     NSString *path = item[@"path"] ? item[@"path"] : item[@"name"];
     if (![FILEMGR fileExistsAtPath:path]) {
         return NO;
@@ -1068,10 +1286,10 @@
 #pragma mark - Path Control
 
 - (void)updatePathControl {
-    NSDictionary *item = nil;
+    Item *item = nil;
     NSInteger selectedRow = [outlineView selectedRow];
     if (selectedRow >= 0) {
-        item = [[outlineView itemAtRow:selectedRow] representedObject];
+        item = [outlineView itemAtRow:selectedRow];
     }
     
     if (item == nil) {
@@ -1153,7 +1371,7 @@
     
     // Dynamically generate contextual menu for item
     else if (menu == itemContextualMenu) {
-        NSDictionary *item = [[outlineView itemAtRow:[outlineView selectedRow]] representedObject];
+        Item *item = [outlineView itemAtRow:[outlineView selectedRow]];
         
         NSMenuItem *openItem = [itemContextualMenu itemAtIndex:0];
         [openItem setImage:nil];
@@ -1191,7 +1409,7 @@
     
     // Dynamically generate Open With submenu for item
     else if (menu == [[itemContextualMenu itemAtIndex:1] submenu] || menu == openWithMenu) {
-        NSDictionary *item = [[outlineView itemAtRow:[outlineView selectedRow]] representedObject];
+        Item *item = [outlineView itemAtRow:[outlineView selectedRow]];
         NSString *path = nil;
         if (item && [item[@"type"] isEqualToString:@"Process"] == NO) {
             path = item[@"path"] ? item[@"path"] : item[@"name"];
@@ -1218,7 +1436,7 @@
         return NO;
     }
     
-    NSDictionary *item = [[outlineView itemAtRow:selectedRow] representedObject];
+    Item *item = [outlineView itemAtRow:selectedRow];
     if (!item && action == @selector(copy:)) {
         return NO;
     }
@@ -1249,7 +1467,7 @@
         return NO;
     }
     
-    if ((action == @selector(refresh:) || action == @selector(toggleAuthentication:)) && isRefreshing) {
+    if (action == @selector(toggleAuthentication:) && [refreshPipeline isRunning]) {
         return NO;
     }
     
@@ -0,0 +1,161 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+@import Foundation;
+
+@class EndpointGraph;
+@class MountTable;
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Handle to a string or other object (e.g. an image) stored in a snapshot.
+// Strings are interned, so equal strings have equal handles.
+typedef uint32_t ObjRef;
+#define NO_REF 0
+
+typedef NS_ENUM(uint8_t, FileType) {
+    FileTypeUnknown = 0,
+    FileTypeFile,
+    FileTypeDirectory,
+    FileTypeIPSocket,
+    FileTypeUnixSocket,
+    FileTypeCharDevice,
+    FileTypePipe,
+    FileTypeError
+};
+
+typedef NS_ENUM(uint8_t, AccessMode) {
+    AccessModeNone = 0,
+    AccessModeRead,
+    AccessModeWrite,
+    AccessModeReadWrite
+};
+
+typedef NS_ENUM(uint8_t, IPVersion) {
+    IPVersionNone = 0,
+    IPVersion4,
+    IPVersion6
+};
+
+enum {
+    ProcessFlagBundle   = 1 << 0,
+    ProcessFlagApp      = 1 << 1
+};
+
+enum {
+    FileFlagHasDevice   = 1 << 0,
+    FileFlagHasInode    = 1 << 1,
+    FileFlagUnknownType = 1 << 2 // lsof reported "unknown file type"
+};
+
+#define NO_UID ((uid_t)-1)
+
+typedef struct {
+    uint64_t startTime;     // Microseconds since the epoch, 0 if unknown
+    pid_t pid;
+    pid_t ppid;             // -1 if unknown
+    uid_t uid;              // NO_UID if unknown
+    int32_t psn;            // Carbon process serial number, -1 if none
+    uint32_t firstFile;     // Index of first file in snapshot's file array
+    uint32_t numFiles;
+    ObjRef name;            // Name reported by lsof, may be truncated
+    ObjRef pname;           // Full process name
+    ObjRef path;
+    ObjRef identifier;      // Bundle identifier
+    ObjRef image;
+    uint8_t flags;
+} ProcessRecord;
+
+typedef struct {
+    uint64_t inode;
+    uint64_t devCharCode;   // Device character code, used to find endpoints
+    uint64_t peerCharCode;  // Device character code of pipe/socket endpoint
+    uint32_t process;       // Index of owning process
+    int32_t fd;             // -1 if not a numeric file descriptor
+    dev_t device;
+    ObjRef fdName;          // Set for non-numeric descriptors, e.g. "cwd" or "txt"
+    ObjRef name;
+    ObjRef protocol;
+    ObjRef socketState;
+    FileType type;
+    AccessMode accessMode;
+    IPVersion ipVersion;
+    uint8_t flags;
+} FileRecord;
+
+NSString * __nullable NameForFileType(FileType type);
+NSString * __nullable NameForAccessMode(AccessMode mode);
+
+// A snapshot holds all processes and open files from a single lsof run as
+// flat arrays of fixed-layout records. Each process's files are stored
+// contiguously. Strings and other objects are referenced via handles.
+// A snapshot is immutable once it has been fully parsed.
+@interface Snapshot : NSObject
+
+@property (readonly) ProcessRecord *processes;
+@property (readonly) NSUInteger processCount;
+@property (readonly) FileRecord *files;
+@property (readonly) NSUInteger fileCount;
+@property (strong, nullable) MountTable *mountTable;
+
+- (NSUInteger)addProcess;
+- (NSUInteger)addFileToProcess:(NSUInteger)processIndex;
+- (void)removeLastFile;
+
+// Append all processes and files in another snapshot to this one
+- (void)appendSnapshot:(Snapshot *)other;
+
+// New snapshot with the processes in this one, except those with the given
+// PIDs, which are replaced by the processes in a partial snapshot listing
+// only them. Those not in the partial snapshot, e.g. because they have
+// exited, are removed. Processes are kept in ascending PID order.
+- (Snapshot *)snapshotByReplacingProcesses:(NSIndexSet *)pids withSnapshot:(Snapshot *)partial;
+
+- (ObjRef)addStringWithBytes:(const char *)bytes length:(NSUInteger)length;
+- (ObjRef)addString:(NSString * __nullable)str;
+- (NSString * __nullable)stringForRef:(ObjRef)ref;
+- (const char * __nullable)bytesForRef:(ObjRef)ref length:(NSUInteger *)length;
+- (BOOL)string:(ObjRef)ref isEqualToString:(ObjRef)otherRef inSnapshot:(Snapshot *)other;
+@property (readonly) NSUInteger stringCount;
+
+- (ObjRef)addObject:(id __nullable)obj;
+- (id __nullable)objectForRef:(ObjRef)ref;
+
+#ifdef DEBUG
+- (void)logStringStatistics;
+#endif
+
+// Build the graph of pipe and socket endpoints
+- (void)resolveEndpoints;
+@property (readonly, nullable) EndpointGraph *endpointGraph;
+
+@end
+
+NS_ASSUME_NONNULL_END
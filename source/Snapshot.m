@@ -0,0 +1,338 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "Snapshot.h"
+
+#import "Common.h"
+#import "StringPool.h"
+#import "EndpointGraph.h"
+
+#define INITIAL_PROCESS_CAPACITY    512
+#define INITIAL_FILE_CAPACITY       8192
+
+NSString * __nullable NameForFileType(FileType type) {
+    switch (type) {
+        case FileTypeFile:          return @"File";
+        case FileTypeDirectory:     return @"Directory";
+        case FileTypeIPSocket:      return @"IP Socket";
+        case FileTypeUnixSocket:    return @"Unix Domain Socket";
+        case FileTypeCharDevice:    return @"Character Device";
+        case FileTypePipe:          return @"Pipe";
+        case FileTypeError:         return @"Error";
+        case FileTypeUnknown:       return nil;
+    }
+    return nil;
+}
+
+NSString * __nullable NameForAccessMode(AccessMode mode) {
+    switch (mode) {
+        case AccessModeRead:        return @"r";
+        case AccessModeWrite:       return @"w";
+        case AccessModeReadWrite:   return @"u";
+        case AccessModeNone:        return nil;
+    }
+    return nil;
+}
+
+static void *GrowArray(void *array, NSUInteger *capacity, size_t elementSize) {
+    NSUInteger newCapacity = *capacity * 2;
+    void *newArray = realloc(array, newCapacity * elementSize);
+    if (newArray == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for snapshot"];
+    }
+    *capacity = newCapacity;
+    return newArray;
+}
+
+@interface Snapshot ()
+{
+    NSUInteger processCapacity;
+    NSUInteger fileCapacity;
+    
+    // Strings referenced by records
+    StringPool *strings;
+    
+    // Other objects referenced by records. Slot 0 is reserved for NO_REF.
+    NSMutableArray *objects;
+    NSMapTable *objectRefs;
+}
+@end
+
+@implementation Snapshot
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        processCapacity = INITIAL_PROCESS_CAPACITY;
+        fileCapacity = INITIAL_FILE_CAPACITY;
+        _processes = malloc(processCapacity * sizeof(ProcessRecord));
+        _files = malloc(fileCapacity * sizeof(FileRecord));
+        if (_processes == NULL || _files == NULL) {
+            [NSException raise:NSMallocException format:@"Failed to allocate memory for snapshot"];
+        }
+        strings = [StringPool new];
+        objects = [NSMutableArray arrayWithObject:[NSNull null]];
+        objectRefs = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsObjectPointerPersonality
+                                           valueOptions:NSPointerFunctionsStrongMemory];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_processes);
+    free(_files);
+}
+
+#pragma mark - Records
+
+- (NSUInteger)addProcess {
+    if (_processCount == processCapacity) {
+        _processes = GrowArray(_processes, &processCapacity, sizeof(ProcessRecord));
+    }
+    ProcessRecord *p = &_processes[_processCount];
+    memset(p, 0, sizeof(ProcessRecord));
+    p->ppid = -1;
+    p->uid = NO_UID;
+    p->psn = -1;
+    p->firstFile = (uint32_t)_fileCount;
+    return _processCount++;
+}
+
+- (NSUInteger)addFileToProcess:(NSUInteger)processIndex {
+    if (_fileCount == fileCapacity) {
+        _files = GrowArray(_files, &fileCapacity, sizeof(FileRecord));
+    }
+    FileRecord *f = &_files[_fileCount];
+    memset(f, 0, sizeof(FileRecord));
+    f->process = (uint32_t)processIndex;
+    f->fd = -1;
+    _processes[processIndex].numFiles += 1;
+    return _fileCount++;
+}
+
+- (void)removeLastFile {
+    if (_fileCount == 0) {
+        return;
+    }
+    _fileCount -= 1;
+    _processes[_files[_fileCount].process].numFiles -= 1;
+}
+
+- (void)appendSnapshot:(Snapshot *)other {
+    if (other->_processCount == 0) {
+        return;
+    }
+    
+    // Remap string and object handles into this snapshot
+    StringHandle *stringMap = [strings mergePool:other->strings];
+    ObjRef *objectMap = [self mapObjectsOfSnapshot:other];
+    [self copyProcesses:NSMakeRange(0, other->_processCount) ofSnapshot:other stringMap:stringMap objectMap:objectMap];
+    free(stringMap);
+    free(objectMap);
+}
+
+- (Snapshot *)snapshotByReplacingProcesses:(NSIndexSet *)pids withSnapshot:(Snapshot *)partial {
+    Snapshot *merged = [Snapshot new];
+    merged.mountTable = partial.mountTable ? partial.mountTable : _mountTable;
+    
+    StringHandle *stringMap = [merged->strings mergePool:strings];
+    ObjRef *objectMap = [merged mapObjectsOfSnapshot:self];
+    StringHandle *partialStringMap = [merged->strings mergePool:partial->strings];
+    ObjRef *partialObjectMap = [merged mapObjectsOfSnapshot:partial];
+    
+    const ProcessRecord *partialProcesses = partial->_processes;
+    NSUInteger partialCount = partial->_processCount;
+    NSUInteger i = 0, j = 0;
+    while (i < _processCount || j < partialCount) {
+        // Copy the run of kept processes preceding the next partial one
+        NSUInteger runStart = i;
+        while (i < _processCount && ![pids containsIndex:_processes[i].pid] &&
+               (j == partialCount || _processes[i].pid < partialProcesses[j].pid)) {
+            i++;
+        }
+        if (i > runStart) {
+            [merged copyProcesses:NSMakeRange(runStart, i - runStart) ofSnapshot:self stringMap:stringMap objectMap:objectMap];
+        }
+        if (i < _processCount && [pids containsIndex:_processes[i].pid]) {
+            i++;
+            continue;
+        }
+        if (j < partialCount) {
+            [merged copyProcesses:NSMakeRange(j, 1) ofSnapshot:partial stringMap:partialStringMap objectMap:partialObjectMap];
+            j++;
+        }
+    }
+    
+    free(stringMap);
+    free(objectMap);
+    free(partialStringMap);
+    free(partialObjectMap);
+    return merged;
+}
+
+// Add the objects of another snapshot to this one. Returns a
+// malloc'd map from handles in the other snapshot to handles here.
+- (ObjRef *)mapObjectsOfSnapshot:(Snapshot *)other {
+    ObjRef *objectMap = malloc([other->objects count] * sizeof(ObjRef));
+    if (objectMap == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for snapshot"];
+    }
+    objectMap[0] = NO_REF;
+    for (NSUInteger i = 1; i < [other->objects count]; i++) {
+        objectMap[i] = [self addObject:other->objects[i]];
+    }
+    return objectMap;
+}
+
+// Append a range of processes in another snapshot, and their files,
+// which are contiguous. Handles are remapped into this snapshot.
+- (void)copyProcesses:(NSRange)range
+           ofSnapshot:(Snapshot *)other
+            stringMap:(const StringHandle *)stringMap
+            objectMap:(const ObjRef *)objectMap {
+    if (range.length == 0) {
+        return;
+    }
+    const ProcessRecord *first = &other->_processes[range.location];
+    const ProcessRecord *last = &other->_processes[NSMaxRange(range) - 1];
+    NSUInteger firstFile = first->firstFile;
+    NSUInteger numFiles = last->firstFile + last->numFiles - firstFile;
+    
+    uint32_t processOffset = (uint32_t)_processCount;
+    uint32_t fileOffset = (uint32_t)_fileCount;
+    
+    while (_processCount + range.length > processCapacity) {
+        _processes = GrowArray(_processes, &processCapacity, sizeof(ProcessRecord));
+    }
+    while (_fileCount + numFiles > fileCapacity) {
+        _files = GrowArray(_files, &fileCapacity, sizeof(FileRecord));
+    }
+    
+    for (NSUInteger i = 0; i < range.length; i++) {
+        ProcessRecord *p = &_processes[_processCount + i];
+        *p = other->_processes[range.location + i];
+        p->firstFile = p->firstFile - (uint32_t)firstFile + fileOffset;
+        p->name = stringMap[p->name];
+        p->pname = stringMap[p->pname];
+        p->path = stringMap[p->path];
+        p->identifier = stringMap[p->identifier];
+        p->image = objectMap[p->image];
+    }
+    for (NSUInteger i = 0; i < numFiles; i++) {
+        FileRecord *f = &_files[_fileCount + i];
+        *f = other->_files[firstFile + i];
+        f->process = f->process - (uint32_t)range.location + processOffset;
+        f->fdName = stringMap[f->fdName];
+        f->name = stringMap[f->name];
+        f->protocol = stringMap[f->protocol];
+        f->socketState = stringMap[f->socketState];
+    }
+    _processCount += range.length;
+    _fileCount += numFiles;
+}
+
+#pragma mark - Strings
+
+- (ObjRef)addStringWithBytes:(const char *)bytes length:(NSUInteger)length {
+    return [strings addBytes:bytes length:length];
+}
+
+- (ObjRef)addString:(NSString * __nullable)str {
+    return [strings addString:str];
+}
+
+- (NSString * __nullable)stringForRef:(ObjRef)ref {
+    return [strings stringForHandle:ref];
+}
+
+- (const char * __nullable)bytesForRef:(ObjRef)ref length:(NSUInteger *)length {
+    return [strings bytesForHandle:ref length:length];
+}
+
+// Compare strings in two snapshots without creating string objects
+- (BOOL)string:(ObjRef)ref isEqualToString:(ObjRef)otherRef inSnapshot:(Snapshot *)other {
+    if (other == self) {
+        return ref == otherRef;
+    }
+    NSUInteger length, otherLength;
+    const char *bytes = [strings bytesForHandle:ref length:&length];
+    const char *otherBytes = [other->strings bytesForHandle:otherRef length:&otherLength];
+    if (bytes == NULL || otherBytes == NULL) {
+        return bytes == otherBytes;
+    }
+    return length == otherLength && memcmp(bytes, otherBytes, length) == 0;
+}
+
+- (NSUInteger)stringCount {
+    return [strings count];
+}
+
+#ifdef DEBUG
+- (void)logStringStatistics {
+    NSUInteger saved = [strings bytesAdded] - [strings bytesStored];
+    double ratio = [strings count] ? (double)[strings numAdded] / [strings count] : 0;
+    DLog(@"Interned %lu strings as %lu unique (%.1fx), saved %lu of %lu bytes",
+         (unsigned long)[strings numAdded], (unsigned long)[strings count], ratio,
+         (unsigned long)saved, (unsigned long)[strings bytesAdded]);
+}
+#endif
+
+#pragma mark - Objects
+
+// Objects are few and shared (e.g. icons), so they are stored once
+// and looked up by identity.
+- (ObjRef)addObject:(id __nullable)obj {
+    if (obj == nil) {
+        return NO_REF;
+    }
+    NSNumber *ref = [objectRefs objectForKey:obj];
+    if (ref) {
+        return [ref unsignedIntValue];
+    }
+    [objects addObject:obj];
+    ObjRef newRef = (ObjRef)([objects count] - 1);
+    [objectRefs setObject:@(newRef) forKey:obj];
+    return newRef;
+}
+
+- (id __nullable)objectForRef:(ObjRef)ref {
+    if (ref == NO_REF || ref >= [objects count]) {
+        return nil;
+    }
+    return objects[ref];
+}
+
+#pragma mark - Endpoints
+
+- (void)resolveEndpoints {
+    _endpointGraph = [[EndpointGraph alloc] initWithSnapshot:self];
+}
+
+@end
@@ -0,0 +1,88 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "SnapshotBackend.h"
+
+#import "Common.h"
+#import "LsofTask.h"
+#import "NativeTask.h"
+#import "FixtureTask.h"
+
+#define BENCHMARK_RUNS  5
+
+@implementation SnapshotBackends
+
++ (id<SnapshotBackend>)backendFromDefaults:(AuthorizationRef __nullable)authRef {
+    NSString *name = [DEFAULTS stringForKey:@"backend"];
+    
+    // Enumerating in-process can't use root privileges,
+    // so authenticated runs always go through lsof
+    if ([name isEqualToString:@"native"] && authRef == NULL) {
+        return [NativeTask new];
+    }
+    if ([name isEqualToString:@"fixture"]) {
+        NSString *path = [DEFAULTS stringForKey:@"fixturePath"];
+        if (path) {
+            return [[FixtureTask alloc] initWithPath:path];
+        }
+        DLog(@"No fixture path set, using lsof");
+    }
+    return [LsofTask new];
+}
+
+#ifdef DEBUG
+// Time each available backend on this host
++ (void)benchmark {
+    NSMutableArray<id<SnapshotBackend>> *backends = [NSMutableArray arrayWithObjects:[LsofTask new], [NativeTask new], nil];
+    NSString *fixturePath = [DEFAULTS stringForKey:@"fixturePath"];
+    if (fixturePath) {
+        [backends addObject:[[FixtureTask alloc] initWithPath:fixturePath]];
+    }
+    
+    for (id<SnapshotBackend> backend in backends) {
+        NSMutableArray<NSNumber *> *times = [NSMutableArray new];
+        Snapshot *snapshot = nil;
+        for (int i = 0; i < BENCHMARK_RUNS; i++) {
+            @autoreleasepool {
+                CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+                snapshot = [backend launch:NULL];
+                [times addObject:@(CFAbsoluteTimeGetCurrent() - start)];
+            }
+        }
+        [times sortUsingSelector:@selector(compare:)];
+        DLog(@"Benchmark %@: min %.3f sec, median %.3f sec (%lu processes, %lu files)",
+             NSStringFromClass([backend class]),
+             [times[0] doubleValue], [times[BENCHMARK_RUNS / 2] doubleValue],
+             (unsigned long)[snapshot processCount], (unsigned long)[snapshot fileCount]);
+    }
+}
+#endif
+
+@end
@@ -0,0 +1,61 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+@import Foundation;
+
+#import "Snapshot.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Matches processes and files in a new snapshot to those in an older one.
+// Processes are identified by PID and start time, files by process, file
+// descriptor and inode (or device character code for pipes and sockets).
+@interface SnapshotDiff : NSObject
+
+@property (readonly, strong) Snapshot *oldSnapshot;
+@property (readonly, strong) Snapshot *snapshot;
+
+@property (readonly) NSUInteger numAddedProcesses;
+@property (readonly) NSUInteger numRemovedProcesses;
+@property (readonly) NSUInteger numAddedFiles;
+@property (readonly) NSUInteger numRemovedFiles;
+@property (readonly) NSUInteger numChangedFiles;
+
++ (instancetype)diffFromSnapshot:(Snapshot *)oldSnapshot toSnapshot:(Snapshot *)snapshot;
+
+// Index in old snapshot of a process or file in the new one, or NSNotFound if it was added
+- (NSUInteger)oldIndexForProcess:(NSUInteger)index;
+- (NSUInteger)oldIndexForFile:(NSUInteger)index;
+// Whether a file present in both snapshots has changed, e.g. its name or socket state
+- (BOOL)fileChanged:(NSUInteger)index;
+
+@end
+
+NS_ASSUME_NONNULL_END
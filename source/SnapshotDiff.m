@@ -0,0 +1,236 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "SnapshotDiff.h"
+
+#import "Common.h"
+#import "StringPool.h"
+
+// Slot in the open-addressing table of a process's old files
+typedef struct {
+    uint64_t key;
+    NSUInteger index;
+} FileSlot;
+
+// Slot index values for slots that hold no unmatched file
+#define SLOT_EMPTY      NSNotFound
+#define SLOT_MATCHED    (NSNotFound - 1)
+
+@interface SnapshotDiff ()
+{
+    NSUInteger *oldProcessIndex;
+    NSUInteger *oldFileIndex;
+    uint8_t *fileChanged;
+}
+@end
+
+@implementation SnapshotDiff
+
++ (instancetype)diffFromSnapshot:(Snapshot *)oldSnapshot toSnapshot:(Snapshot *)snapshot {
+    return [[self alloc] initWithSnapshot:oldSnapshot toSnapshot:snapshot];
+}
+
+- (instancetype)initWithSnapshot:(Snapshot *)oldSnapshot toSnapshot:(Snapshot *)snapshot {
+    self = [super init];
+    if (self) {
+        _oldSnapshot = oldSnapshot;
+        _snapshot = snapshot;
+        oldProcessIndex = malloc(MAX([snapshot processCount], 1) * sizeof(NSUInteger));
+        oldFileIndex = malloc(MAX([snapshot fileCount], 1) * sizeof(NSUInteger));
+        fileChanged = calloc(MAX([snapshot fileCount], 1), sizeof(uint8_t));
+        if (oldProcessIndex == NULL || oldFileIndex == NULL || fileChanged == NULL) {
+            [NSException raise:NSMallocException format:@"Failed to allocate memory for snapshot diff"];
+        }
+        [self compare];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(oldProcessIndex);
+    free(oldFileIndex);
+    free(fileChanged);
+}
+
+#pragma mark - Compare
+
+// Hash of the values identifying a file within its process
+static uint64_t FileKey(Snapshot *s, FileRecord *f) {
+    uint64_t key = (uint64_t)(uint32_t)f->fd;
+    if (f->fd == -1) {
+        NSUInteger length = 0;
+        const char *bytes = [s bytesForRef:f->fdName length:&length];
+        key = StringPoolHashBytes(bytes, length) | ((uint64_t)1 << 63);
+    }
+    uint64_t identity = (f->flags & FileFlagHasInode) ? f->inode : f->devCharCode;
+    return (key * 0x9E3779B97F4A7C15ULL) ^ identity ^ ((uint64_t)f->type << 56);
+}
+
+static BOOL SameFile(Snapshot *s1, FileRecord *f1, Snapshot *s2, FileRecord *f2) {
+    if (f1->fd != f2->fd || f1->type != f2->type || f1->inode != f2->inode || f1->devCharCode != f2->devCharCode) {
+        return NO;
+    }
+    return f1->fd != -1 || [s1 string:f1->fdName isEqualToString:f2->fdName inSnapshot:s2];
+}
+
+static BOOL FileContentsDiffer(Snapshot *s1, FileRecord *f1, Snapshot *s2, FileRecord *f2) {
+    return f1->accessMode != f2->accessMode ||
+           f1->peerCharCode != f2->peerCharCode ||
+           ![s1 string:f1->name isEqualToString:f2->name inSnapshot:s2] ||
+           ![s1 string:f1->socketState isEqualToString:f2->socketState inSnapshot:s2];
+}
+
+- (void)compare {
+#ifdef DEBUG
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+#endif
+    Snapshot *old = _oldSnapshot;
+    Snapshot *new = _snapshot;
+    
+    for (NSUInteger i = 0; i < [new fileCount]; i++) {
+        oldFileIndex[i] = NSNotFound;
+    }
+    
+    // Map PIDs in old snapshot to process index
+    NSMutableDictionary<NSNumber*, NSNumber*> *oldPIDs = [NSMutableDictionary dictionaryWithCapacity:[old processCount]];
+    NSUInteger maxOldFiles = 0;
+    for (NSUInteger i = 0; i < [old processCount]; i++) {
+        oldPIDs[@(old.processes[i].pid)] = @(i);
+        maxOldFiles = MAX(maxOldFiles, old.processes[i].numFiles);
+    }
+    
+    // File table is allocated once for the largest process, and each
+    // process uses the smallest power of two at least twice its file count
+    NSUInteger maxSlots = 2;
+    while (maxSlots < maxOldFiles * 2) {
+        maxSlots <<= 1;
+    }
+    FileSlot *slots = malloc(maxSlots * sizeof(FileSlot));
+    if (slots == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for snapshot diff"];
+    }
+    
+    NSUInteger numMatchedProcesses = 0;
+    NSUInteger numMatchedFiles = 0;
+    
+    for (NSUInteger i = 0; i < [new processCount]; i++) {
+        ProcessRecord *p = &new.processes[i];
+        oldProcessIndex[i] = NSNotFound;
+        
+        NSNumber *oldIdx = oldPIDs[@(p->pid)];
+        if (oldIdx == nil) {
+            continue;
+        }
+        ProcessRecord *op = &old.processes[[oldIdx unsignedIntegerValue]];
+        // Same PID but a different process
+        if (p->startTime && op->startTime && p->startTime != op->startTime) {
+            continue;
+        }
+        oldProcessIndex[i] = [oldIdx unsignedIntegerValue];
+        numMatchedProcesses += 1;
+        
+        // Add the old process's files to the table. Files sharing a key
+        // are all kept, in successive slots.
+        NSUInteger numSlots = 2;
+        while (numSlots < op->numFiles * 2) {
+            numSlots <<= 1;
+        }
+        NSUInteger mask = numSlots - 1;
+        for (NSUInteger k = 0; k < numSlots; k++) {
+            slots[k].index = SLOT_EMPTY;
+        }
+        for (NSUInteger j = op->firstFile; j < op->firstFile + op->numFiles; j++) {
+            uint64_t key = FileKey(old, &old.files[j]);
+            NSUInteger k = (NSUInteger)(key ^ (key >> 32)) & mask;
+            while (slots[k].index != SLOT_EMPTY) {
+                k = (k + 1) & mask;
+            }
+            slots[k].key = key;
+            slots[k].index = j;
+        }
+        
+        // Match the new process's files against the table
+        for (NSUInteger j = p->firstFile; j < p->firstFile + p->numFiles; j++) {
+            FileRecord *f = &new.files[j];
+            uint64_t key = FileKey(new, f);
+            NSUInteger k = (NSUInteger)(key ^ (key >> 32)) & mask;
+            FileRecord *of = NULL;
+            for (; slots[k].index != SLOT_EMPTY; k = (k + 1) & mask) {
+                if (slots[k].index == SLOT_MATCHED || slots[k].key != key) {
+                    continue;
+                }
+                if (SameFile(new, f, old, &old.files[slots[k].index])) {
+                    of = &old.files[slots[k].index];
+                    break;
+                }
+            }
+            if (of == NULL) {
+                continue;
+            }
+            oldFileIndex[j] = slots[k].index;
+            slots[k].index = SLOT_MATCHED;
+            numMatchedFiles += 1;
+            
+            if (FileContentsDiffer(new, f, old, of)) {
+                fileChanged[j] = 1;
+                _numChangedFiles += 1;
+            }
+        }
+    }
+    free(slots);
+    
+    _numAddedProcesses = [new processCount] - numMatchedProcesses;
+    _numRemovedProcesses = [old processCount] - numMatchedProcesses;
+    _numAddedFiles = [new fileCount] - numMatchedFiles;
+    _numRemovedFiles = [old fileCount] - numMatchedFiles;
+    
+#ifdef DEBUG
+    DLog(@"Snapshot diff: +%lu/-%lu processes, +%lu/-%lu/~%lu files in %.3f sec",
+         (unsigned long)_numAddedProcesses, (unsigned long)_numRemovedProcesses,
+         (unsigned long)_numAddedFiles, (unsigned long)_numRemovedFiles, (unsigned long)_numChangedFiles,
+         CFAbsoluteTimeGetCurrent() - startTime);
+#endif
+}
+
+#pragma mark - Results
+
+- (NSUInteger)oldIndexForProcess:(NSUInteger)index {
+    return oldProcessIndex[index];
+}
+
+- (NSUInteger)oldIndexForFile:(NSUInteger)index {
+    return oldFileIndex[index];
+}
+
+- (BOOL)fileChanged:(NSUInteger)index {
+    return fileChanged[index] != 0;
+}
+
+@end
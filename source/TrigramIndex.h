@@ -0,0 +1,61 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class Snapshot;
+
+// Inverted index from trigrams to the strings that contain them, used to
+// rule out most strings before substring matching. Strings are indexed by
+// content, shared by all snapshots, so only strings not seen in an earlier
+// snapshot need to be indexed after a refresh. Trigrams are ASCII
+// lowercased, so the index serves both case-sensitive and insensitive
+// search. Strings containing non-ASCII characters are never ruled out.
+@interface TrigramIndex : NSObject
+
++ (instancetype)sharedIndex;
+
+// Index the strings of a complete snapshot. Can be called from any thread.
+- (void)indexSnapshot:(Snapshot *)snapshot;
+
+// Set marks[h] to value for each string handle h in the snapshot that
+// cannot contain the substring. Returns NO without marking anything if
+// the substring is too short, the snapshot hasn't been indexed yet or
+// the index is being updated.
+- (BOOL)markStrings:(uint8_t *)marks
+         ofSnapshot:(Snapshot *)snapshot
+      notContaining:(NSString *)substring
+              value:(uint8_t)value;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,427 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "TrigramIndex.h"
+
+#import "Common.h"
+#import "Snapshot.h"
+#import "StringPool.h"
+
+#import <os/lock.h>
+
+#define INITIAL_TABLE_SIZE      65536 // Must be a power of 2
+#define INITIAL_POSTING_SIZE    4
+
+// Start over once most indexed strings are no longer in use
+#define MIN_COMPACT_COUNT       (256 * 1024)
+#define COMPACT_FACTOR          4
+
+typedef struct {
+    uint32_t trigram;   // 0 for an empty slot
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *ids;      // IDs of strings containing trigram, ascending
+} Posting;
+
+// Allocation failures are reported rather than raised, so that the
+// lock can be released before raising. The buffer is kept on failure.
+static BOOL GrowBuffer(void **buffer, NSUInteger newSize) {
+    void *newBuffer = realloc(*buffer, newSize);
+    if (newBuffer == NULL) {
+        return NO;
+    }
+    *buffer = newBuffer;
+    return YES;
+}
+
+static void RaiseMallocException(void) {
+    [NSException raise:NSMallocException format:@"Failed to allocate memory for trigram index"];
+}
+
+static inline uint8_t Fold(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// Tagged so that no trigram is 0
+static inline uint32_t Trigram(const uint8_t *bytes) {
+    return (1u << 24) | ((uint32_t)Fold(bytes[0]) << 16) | ((uint32_t)Fold(bytes[1]) << 8) | Fold(bytes[2]);
+}
+
+static inline BOOL IsASCII(const uint8_t *bytes, NSUInteger length) {
+    for (NSUInteger i = 0; i < length; i++) {
+        if (bytes[i] & 0x80) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+// First index at or after start where ids[index] >= value
+static inline NSUInteger LowerBound(const uint32_t *ids, NSUInteger start, NSUInteger count, uint32_t value) {
+    NSUInteger lo = start;
+    NSUInteger hi = count;
+    while (lo < hi) {
+        NSUInteger mid = lo + (hi - lo) / 2;
+        if (ids[mid] < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static int ComparePostingCounts(const void *a, const void *b) {
+    uint32_t ca = (*(const Posting **)a)->count;
+    uint32_t cb = (*(const Posting **)b)->count;
+    return (ca > cb) - (ca < cb);
+}
+
+@interface TrigramIndex ()
+{
+    os_unfair_lock lock;
+    
+    // Indexed strings by content. A string's ID is its handle in the pool.
+    StringPool *pool;
+    NSUInteger indexedCount;
+    
+    // Open addressing hash table of posting lists
+    Posting *postings;
+    NSUInteger tableSize;
+    NSUInteger numTrigrams;
+    
+    // IDs of strings with non-ASCII characters, which always need checking
+    uint32_t *nonASCII;
+    NSUInteger nonASCIICount;
+    NSUInteger nonASCIICapacity;
+    
+    // ID of each string handle in an indexed snapshot
+    NSMapTable<Snapshot *, NSData *> *snapshotIDs;
+}
+@end
+
+@implementation TrigramIndex
+
++ (instancetype)sharedIndex {
+    static TrigramIndex *sharedIndex;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedIndex = [TrigramIndex new];
+    });
+    return sharedIndex;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        lock = OS_UNFAIR_LOCK_INIT;
+        snapshotIDs = [NSMapTable weakToStrongObjectsMapTable];
+        if (![self reset]) {
+            RaiseMallocException();
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self freePostings];
+    free(nonASCII);
+}
+
+- (void)freePostings {
+    for (NSUInteger i = 0; i < tableSize; i++) {
+        free(postings[i].ids);
+    }
+    free(postings);
+    postings = NULL;
+    tableSize = 0;
+}
+
+// Returns NO if out of memory, leaving the index empty
+- (BOOL)reset {
+    [self freePostings];
+    numTrigrams = 0;
+    pool = [StringPool new];
+    indexedCount = 0;
+    nonASCIICount = 0;
+    [snapshotIDs removeAllObjects];
+    
+    postings = calloc(INITIAL_TABLE_SIZE, sizeof(Posting));
+    if (postings == NULL) {
+        return NO;
+    }
+    tableSize = INITIAL_TABLE_SIZE;
+    return YES;
+}
+
+#pragma mark - Build
+
+- (void)indexSnapshot:(Snapshot *)snapshot {
+#ifdef DEBUG
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+#endif
+    NSUInteger numStrings = [snapshot stringCount];
+    NSMutableData *data = [NSMutableData dataWithLength:(numStrings + 1) * sizeof(uint32_t)];
+    if (data == nil) {
+        RaiseMallocException();
+    }
+    uint32_t *ids = [data mutableBytes];
+    
+    os_unfair_lock_lock(&lock);
+    
+    if ([snapshotIDs objectForKey:snapshot]) {
+        os_unfair_lock_unlock(&lock);
+        return;
+    }
+    BOOL ok = (postings != NULL);
+    if (!ok || [pool count] > MAX(MIN_COMPACT_COUNT, numStrings * COMPACT_FACTOR)) {
+        DLog(@"Rebuilding trigram index of %lu strings", (unsigned long)[pool count]);
+        ok = [self reset];
+    }
+    
+#ifdef DEBUG
+    NSUInteger previousCount = indexedCount;
+#endif
+    // A string that fails to be indexed is indexed again next time,
+    // since its ID is still above the indexed count
+    for (ObjRef h = 1; h <= numStrings && ok; h++) {
+        NSUInteger length;
+        const char *bytes = [snapshot bytesForRef:h length:&length];
+        StringHandle stringID = [pool addBytes:bytes length:length];
+        if (stringID > indexedCount) {
+            ok = [self indexString:stringID bytes:(const uint8_t *)bytes length:length];
+            if (ok) {
+                indexedCount = stringID;
+            }
+        }
+        ids[h] = stringID;
+    }
+    if (ok) {
+        [snapshotIDs setObject:data forKey:snapshot];
+    }
+    
+    os_unfair_lock_unlock(&lock);
+    
+    if (!ok) {
+        RaiseMallocException();
+    }
+    
+#ifdef DEBUG
+    DLog(@"Indexed %lu new of %lu strings (%lu trigrams) in %.3f sec",
+         (unsigned long)(indexedCount - previousCount), (unsigned long)numStrings,
+         (unsigned long)numTrigrams, CFAbsoluteTimeGetCurrent() - start);
+#endif
+}
+
+// Returns NO if out of memory
+- (BOOL)indexString:(uint32_t)stringID bytes:(const uint8_t *)bytes length:(NSUInteger)length {
+    if (!IsASCII(bytes, length)) {
+        if (nonASCIICount == nonASCIICapacity) {
+            NSUInteger newCapacity = nonASCIICapacity ? nonASCIICapacity * 2 : 1024;
+            if (!GrowBuffer((void **)&nonASCII, newCapacity * sizeof(uint32_t))) {
+                return NO;
+            }
+            nonASCIICapacity = newCapacity;
+        }
+        nonASCII[nonASCIICount++] = stringID;
+        return YES;
+    }
+    for (NSUInteger i = 0; i + 3 <= length; i++) {
+        Posting *p = [self postingForTrigram:Trigram(&bytes[i]) create:YES];
+        if (p == NULL) {
+            return NO;
+        }
+        // IDs are indexed in ascending order, so a repeated
+        // trigram in the same string is always the last one
+        if (p->count && p->ids[p->count - 1] == stringID) {
+            continue;
+        }
+        if (p->count == p->capacity) {
+            uint32_t newCapacity = p->capacity ? p->capacity * 2 : INITIAL_POSTING_SIZE;
+            if (!GrowBuffer((void **)&p->ids, newCapacity * sizeof(uint32_t))) {
+                return NO;
+            }
+            p->capacity = newCapacity;
+        }
+        p->ids[p->count++] = stringID;
+    }
+    return YES;
+}
+
+// Returns NULL if not found, or if out of memory when creating
+- (Posting * __nullable)postingForTrigram:(uint32_t)trigram create:(BOOL)create {
+    NSUInteger mask = tableSize - 1;
+    NSUInteger slot = (trigram * 2654435761u) & mask;
+    while (postings[slot].trigram != 0) {
+        if (postings[slot].trigram == trigram) {
+            return &postings[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (!create) {
+        return NULL;
+    }
+    
+    // Keep load factor at or below 1/2
+    if ((numTrigrams + 1) * 2 > tableSize) {
+        if (![self rehash]) {
+            return NULL;
+        }
+        return [self postingForTrigram:trigram create:YES];
+    }
+    postings[slot].trigram = trigram;
+    numTrigrams += 1;
+    return &postings[slot];
+}
+
+// Returns NO if out of memory, leaving the table as it was
+- (BOOL)rehash {
+    NSUInteger newSize = tableSize * 2;
+    Posting *newPostings = calloc(newSize, sizeof(Posting));
+    if (newPostings == NULL) {
+        return NO;
+    }
+    NSUInteger mask = newSize - 1;
+    for (NSUInteger i = 0; i < tableSize; i++) {
+        if (postings[i].trigram == 0) {
+            continue;
+        }
+        NSUInteger slot = (postings[i].trigram * 2654435761u) & mask;
+        while (newPostings[slot].trigram != 0) {
+            slot = (slot + 1) & mask;
+        }
+        newPostings[slot] = postings[i];
+    }
+    free(postings);
+    postings = newPostings;
+    tableSize = newSize;
+    return YES;
+}
+
+#pragma mark - Search
+
+- (BOOL)markStrings:(uint8_t *)marks
+         ofSnapshot:(Snapshot *)snapshot
+      notContaining:(NSString *)substring
+              value:(uint8_t)value {
+    NSData *utf8 = [substring dataUsingEncoding:NSUTF8StringEncoding];
+    const uint8_t *bytes = [utf8 bytes];
+    NSUInteger length = [utf8 length];
+    if (length < 3 || !IsASCII(bytes, length)) {
+        return NO;
+    }
+    
+    // Don't wait for the index to be updated
+    if (!os_unfair_lock_trylock(&lock)) {
+        return NO;
+    }
+    NSData *data = [snapshotIDs objectForKey:snapshot];
+    if (data == nil) {
+        os_unfair_lock_unlock(&lock);
+        return NO;
+    }
+    
+    // Posting lists of the substring's trigrams, shortest first
+    NSUInteger numLists = length - 2;
+    const Posting **lists = malloc(numLists * sizeof(Posting *));
+    if (lists == NULL) {
+        os_unfair_lock_unlock(&lock);
+        RaiseMallocException();
+    }
+    BOOL missing = NO;
+    for (NSUInteger i = 0; i < numLists && !missing; i++) {
+        lists[i] = [self postingForTrigram:Trigram(&bytes[i]) create:NO];
+        missing = (lists[i] == NULL);
+    }
+    
+    // Intersect into candidate IDs
+    uint32_t *candidates = NULL;
+    NSUInteger numCandidates = 0;
+    if (!missing) {
+        qsort(lists, numLists, sizeof(Posting *), ComparePostingCounts);
+        numCandidates = lists[0]->count;
+        candidates = malloc(MAX(numCandidates, 1) * sizeof(uint32_t));
+        if (candidates == NULL) {
+            free(lists);
+            os_unfair_lock_unlock(&lock);
+            RaiseMallocException();
+        }
+        memcpy(candidates, lists[0]->ids, numCandidates * sizeof(uint32_t));
+        for (NSUInteger i = 1; i < numLists && numCandidates; i++) {
+            const Posting *p = lists[i];
+            NSUInteger kept = 0;
+            NSUInteger pos = 0;
+            for (NSUInteger j = 0; j < numCandidates; j++) {
+                pos = LowerBound(p->ids, pos, p->count, candidates[j]);
+                if (pos == p->count) {
+                    break;
+                }
+                if (p->ids[pos] == candidates[j]) {
+                    candidates[kept++] = candidates[j];
+                }
+            }
+            numCandidates = kept;
+        }
+    }
+    free(lists);
+    
+    uint8_t *isCandidate = calloc([pool count] + 1, sizeof(uint8_t));
+    if (isCandidate == NULL) {
+        free(candidates);
+        os_unfair_lock_unlock(&lock);
+        RaiseMallocException();
+    }
+    for (NSUInteger i = 0; i < numCandidates; i++) {
+        isCandidate[candidates[i]] = 1;
+    }
+    for (NSUInteger i = 0; i < nonASCIICount; i++) {
+        isCandidate[nonASCII[i]] = 1;
+    }
+    free(candidates);
+    
+    const uint32_t *ids = [data bytes];
+    NSUInteger numStrings = [data length] / sizeof(uint32_t) - 1;
+    NSUInteger numMarked = 0;
+    for (NSUInteger h = 1; h <= numStrings; h++) {
+        if (!isCandidate[ids[h]]) {
+            marks[h] = value;
+            numMarked++;
+        }
+    }
+    free(isCandidate);
+    
+    os_unfair_lock_unlock(&lock);
+    
+    DLog(@"Trigram index leaves %lu of %lu strings to check for \"%@\"",
+         (unsigned long)(numStrings - numMarked), (unsigned long)numStrings, substring);
+    return YES;
+}
+
+@end
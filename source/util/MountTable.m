@@ -0,0 +1,173 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "MountTable.h"
+
+@import AppKit;
+
+#import "Common.h"
+
+#import <sys/param.h>
+#import <sys/mount.h>
+
+NSString * const MountTableDidChangeNotification = @"MountTableDidChangeNotification";
+
+typedef struct {
+    dev_t devid;
+    uint32_t index; // Index into fileSystems
+} MountRecord;
+
+static MountTable *currentTable = nil;
+static NSUInteger currentGeneration = 0;
+
+@interface MountTable ()
+{
+    MountRecord *records;
+    NSUInteger count;
+}
+@end
+
+@implementation MountTable
+
++ (MountTable *)currentTable {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSNotificationCenter *nc = [[NSWorkspace sharedWorkspace] notificationCenter];
+        for (NSString *name in @[NSWorkspaceDidMountNotification,
+                                 NSWorkspaceDidUnmountNotification,
+                                 NSWorkspaceDidRenameVolumeNotification]) {
+            [nc addObserver:self
+                   selector:@selector(volumesChanged:)
+                       name:name
+                     object:nil];
+        }
+    });
+    
+    @synchronized(self) {
+        if (currentTable == nil) {
+            currentTable = [[MountTable alloc] initWithGeneration:currentGeneration];
+        }
+        return currentTable;
+    }
+}
+
++ (void)volumesChanged:(NSNotification *)notification {
+    @synchronized(self) {
+        currentGeneration += 1;
+        currentTable = [[MountTable alloc] initWithGeneration:currentGeneration];
+    }
+    [[NSNotificationCenter defaultCenter] postNotificationName:MountTableDidChangeNotification
+                                                        object:self];
+}
+
+- (instancetype)initWithGeneration:(NSUInteger)generation {
+    self = [super init];
+    if (self) {
+        _generation = generation;
+        _fileSystems = @[];
+        [self load];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(records);
+}
+
+- (void)load {
+    int fs_count = getfsstat(NULL, 0, MNT_NOWAIT);
+    if (fs_count <= 0) {
+        DLog(@"getfsstat failed: %d", errno);
+        return;
+    }
+    
+    // Allocate buffer from heap to handle an arbitrary number of filesystems
+    struct statfs *buf = malloc(fs_count * sizeof(struct statfs));
+    records = malloc(fs_count * sizeof(MountRecord));
+    if (buf == NULL || records == NULL) {
+        free(buf);
+        return;
+    }
+    
+    fs_count = getfsstat(buf, fs_count * (int)sizeof(struct statfs), MNT_NOWAIT);
+    
+    NSMutableArray<NSDictionary *> *fileSystems = [NSMutableArray arrayWithCapacity:MAX(fs_count, 0)];
+    for (int i = 0; i < fs_count; ++i) {
+        dev_t fsid = buf[i].f_fsid.val[0];
+        NSString *mountpoint = @(buf[i].f_mntonname);
+        
+        NSMutableDictionary *fs = [@{
+            @"devid": @(fsid),
+            @"devid_major": @(major(fsid)),
+            @"devid_minor": @(minor(fsid)),
+            @"fstype": @(buf[i].f_fstypename),
+            @"devname": @(buf[i].f_mntfromname),
+            @"mountpoint": mountpoint
+        } mutableCopy];
+        
+        NSString *volumeName = nil;
+        [[NSURL fileURLWithPath:mountpoint] getResourceValue:&volumeName forKey:NSURLVolumeNameKey error:nil];
+        if (volumeName) {
+            fs[@"volumename"] = volumeName;
+        }
+        
+        records[count].devid = fsid;
+        records[count].index = (uint32_t)[fileSystems count];
+        count++;
+        [fileSystems addObject:[fs copy]];
+    }
+    free(buf);
+    
+    qsort_b(records, count, sizeof(MountRecord), ^int(const void *a, const void *b) {
+        dev_t da = ((const MountRecord *)a)->devid;
+        dev_t db = ((const MountRecord *)b)->devid;
+        return (da > db) - (da < db);
+    });
+    
+    _fileSystems = [fileSystems copy];
+}
+
+- (NSDictionary * __nullable)fileSystemForDevice:(dev_t)devid {
+    NSUInteger lo = 0, hi = count;
+    while (lo < hi) {
+        NSUInteger mid = (lo + hi) / 2;
+        if (records[mid].devid < devid) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < count && records[lo].devid == devid) {
+        return _fileSystems[records[lo].index];
+    }
+    return nil;
+}
+
+@end
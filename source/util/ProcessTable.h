@@ -1,5 +1,5 @@
 /*
-    Copyright (c) 2004-2025, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
     All rights reserved.
 
     Redistribution and use in source and binary forms, with or without modification,
@@ -28,50 +28,38 @@
     POSSIBILITY OF SUCH DAMAGE.
 */
 
-#import "FSUtils.h"
-
-#import "Common.h"
+@import Foundation;
 
 #import <sys/param.h>
-#import <sys/mount.h>
-
-@implementation FSUtils
-
-+ (NSDictionary<NSNumber*, NSDictionary*> *)mountedFileSystems {
-    
-    int fs_count = getfsstat(NULL, 0, MNT_NOWAIT);
-    if (fs_count == -1) {
-        fprintf(stderr, "Error: %d\n", errno);
-        return @{};
-    }
-    
-    // Allocate buffer from heap to handle an arbitrary number of filesystems
-    struct statfs *buf = malloc(fs_count * sizeof(struct statfs));
-    if (buf == NULL) {
-        fprintf(stderr, "Failed to allocate memory for file system stats.\n");
-        return @{};
-    }
-    
-    getfsstat(buf, fs_count * sizeof(struct statfs), MNT_NOWAIT);
-    
-    NSMutableDictionary<NSString *, id> *fsdict = [NSMutableDictionary new];
-    
-    for (int i = 0; i < fs_count; ++i) {
-        dev_t fsid = buf[i].f_fsid.val[0];
-        
-        fsdict[@(fsid)] = @{
-            @"devid": @(fsid),
-            @"devid_major": @(major(fsid)),
-            @"devid_minor": @(minor(fsid)),
-            @"fstype": @(buf[i].f_fstypename),
-            @"devname": @(buf[i].f_mntfromname),
-            @"mountpoint": @(buf[i].f_mntonname)
-        };
-    }
-    
-    free(buf);
-    
-    return [fsdict copy]; // Return immutable copy
-}
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef struct {
+    uint64_t startTime; // µs since the epoch
+    pid_t pid;
+    pid_t ppid;
+    uid_t uid;
+    char status; // SIDL, SRUN, SSLEEP, SSTOP or SZOMB
+    char comm[MAXCOMLEN + 1];
+} ProcessTableEntry;
+
+// All running processes, fetched with a single KERN_PROC_ALL sysctl
+// and indexed by PID. Tables are immutable once loaded.
+@interface ProcessTable : NSObject
+
+@property (readonly) NSUInteger count;
+@property (readonly) const ProcessTableEntry *entries;
+
++ (instancetype __nullable)load;
+
+// Most recently loaded table, shared by all per-PID lookups
++ (ProcessTable * __nullable)currentTable;
++ (ProcessTable * __nullable)reloadCurrentTable;
+
+// Copy out the entry for a PID, so it stays valid
+// if the table is released by another thread
+- (BOOL)getEntry:(ProcessTableEntry *)entry forPID:(pid_t)pid;
 
 @end
+
+NS_ASSUME_NONNULL_END
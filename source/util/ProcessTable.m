@@ -0,0 +1,193 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "ProcessTable.h"
+
+#import <sys/sysctl.h>
+
+#import "Common.h"
+
+#define INDEX_EMPTY UINT32_MAX
+
+static ProcessTable *currentTable = nil;
+
+@interface ProcessTable ()
+{
+    ProcessTableEntry *entries;
+    NSUInteger count;
+    
+    // Open addressing hash index into entries, keyed by PID
+    uint32_t *slots;
+    NSUInteger slotMask;
+}
+@end
+
+@implementation ProcessTable
+
++ (ProcessTable * __nullable)currentTable {
+    @synchronized(self) {
+        return currentTable;
+    }
+}
+
++ (ProcessTable * __nullable)reloadCurrentTable {
+    ProcessTable *table = [ProcessTable load];
+    @synchronized(self) {
+        if (table) {
+            currentTable = table;
+        }
+        return currentTable;
+    }
+}
+
++ (instancetype __nullable)load {
+#ifdef DEBUG
+    NSDate *start = [NSDate date];
+#endif
+    int mib[3] = { CTL_KERN, KERN_PROC, KERN_PROC_ALL };
+    struct kinfo_proc *procs = NULL;
+    size_t size = 0;
+    
+    // The process list can grow between the size query and the
+    // fetch, so leave some headroom and retry if it was not enough
+    for (int attempt = 0; attempt < 4; attempt++) {
+        if (sysctl(mib, 3, NULL, &size, NULL, 0) != 0) {
+            free(procs);
+            return nil;
+        }
+        size += size / 8;
+        struct kinfo_proc *buf = realloc(procs, size);
+        if (buf == NULL) {
+            free(procs);
+            return nil;
+        }
+        procs = buf;
+        if (sysctl(mib, 3, procs, &size, NULL, 0) == 0) {
+            break;
+        }
+        if (errno != ENOMEM) {
+            free(procs);
+            return nil;
+        }
+        size = 0;
+    }
+    if (size == 0) {
+        free(procs);
+        return nil;
+    }
+    
+    NSUInteger num = size / sizeof(struct kinfo_proc);
+    ProcessTable *table = [[ProcessTable alloc] initWithProcesses:procs count:num];
+    free(procs);
+    
+    DLog(@"Loaded process table with %lu processes in %.3f sec",
+         (unsigned long)num, [[NSDate date] timeIntervalSinceDate:start]);
+    
+    return table;
+}
+
+- (instancetype)initWithProcesses:(const struct kinfo_proc *)procs count:(NSUInteger)num {
+    self = [super init];
+    if (self) {
+        entries = calloc(MAX(num, 1), sizeof(ProcessTableEntry));
+        if (entries == NULL) {
+            [NSException raise:NSMallocException format:@"Failed to allocate memory for process table"];
+        }
+        count = num;
+        
+        for (NSUInteger i = 0; i < num; i++) {
+            const struct kinfo_proc *kp = &procs[i];
+            ProcessTableEntry *e = &entries[i];
+            e->pid = kp->kp_proc.p_pid;
+            e->ppid = kp->kp_eproc.e_ppid;
+            e->uid = kp->kp_eproc.e_ucred.cr_uid;
+            e->status = kp->kp_proc.p_stat;
+            e->startTime = ((uint64_t)kp->kp_proc.p_starttime.tv_sec * 1000000) + kp->kp_proc.p_starttime.tv_usec;
+            strlcpy(e->comm, kp->kp_proc.p_comm, sizeof(e->comm));
+        }
+        
+        // Keep the load factor at or below 0.5
+        NSUInteger numSlots = 16;
+        while (numSlots < num * 2) {
+            numSlots <<= 1;
+        }
+        slotMask = numSlots - 1;
+        slots = malloc(numSlots * sizeof(uint32_t));
+        if (slots == NULL) {
+            [NSException raise:NSMallocException format:@"Failed to allocate memory for process table"];
+        }
+        memset(slots, 0xFF, numSlots * sizeof(uint32_t));
+        
+        for (NSUInteger i = 0; i < num; i++) {
+            NSUInteger s = (NSUInteger)entries[i].pid & slotMask;
+            while (slots[s] != INDEX_EMPTY) {
+                s = (s + 1) & slotMask;
+            }
+            slots[s] = (uint32_t)i;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(entries);
+    free(slots);
+}
+
+- (NSUInteger)count {
+    return count;
+}
+
+- (const ProcessTableEntry *)entries {
+    return entries;
+}
+
+- (const ProcessTableEntry * __nullable)entryForPID:(pid_t)pid {
+    NSUInteger s = (NSUInteger)pid & slotMask;
+    while (slots[s] != INDEX_EMPTY) {
+        ProcessTableEntry *e = &entries[slots[s]];
+        if (e->pid == pid) {
+            return e;
+        }
+        s = (s + 1) & slotMask;
+    }
+    return NULL;
+}
+
+- (BOOL)getEntry:(ProcessTableEntry *)entry forPID:(pid_t)pid {
+    const ProcessTableEntry *e = [self entryForPID:pid];
+    if (e == NULL) {
+        return NO;
+    }
+    *entry = *e;
+    return YES;
+}
+
+@end
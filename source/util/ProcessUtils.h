@@ -39,6 +39,8 @@ NS_ASSUME_NONNULL_BEGIN
 + (NSString * __nullable)identifierForBundleAtPath:(NSString * __nullable)path;
 + (BOOL)isProcessOwnedByCurrentUser:(pid_t)pid;
 + (uid_t)UIDForPID:(pid_t)pid;
++ (uid_t)tableUIDForPID:(pid_t)pid;
++ (uint64_t)startTimeForPID:(pid_t)pid;
 + (NSString * __nullable)ownerUserNameForPID:(pid_t)pid;
 + (NSString * __nullable)macProcessNameForPID:(pid_t)pid;
 + (NSString * __nullable)carbonProcessSerialNumberForPID:(pid_t)pid;
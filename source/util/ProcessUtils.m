@@ -31,6 +31,7 @@
 #import "ProcessUtils.h"
 
 #import "STPrivilegedTask.h"
+#import "ProcessTable.h"
 
 #import <libproc.h>
 #import <sys/sysctl.h>
@@ -71,23 +72,54 @@
 
 #define SYSCTL_PATH_LEN 4
 
-+ (uid_t)UIDForPID:(pid_t)pid {
-    uid_t uid = -1;
-    
+// Look up a single process with sysctl
+static BOOL LookUpProcessEntry(pid_t pid, ProcessTableEntry *entry) {
     struct kinfo_proc process;
     size_t proc_buf_size = sizeof(process);
-    
-    // Compose search path for sysctl.
     int path[SYSCTL_PATH_LEN] = {CTL_KERN, KERN_PROC, KERN_PROC_PID, pid};
     
-    int sysctl_result = sysctl(path, SYSCTL_PATH_LEN, &process, &proc_buf_size, NULL, 0);
-    
-    // If sysctl did not fail and process with PID available - take UID.
-    if ((sysctl_result == 0) && (proc_buf_size != 0)) {
-        uid = process.kp_eproc.e_ucred.cr_uid;
+    if (sysctl(path, SYSCTL_PATH_LEN, &process, &proc_buf_size, NULL, 0) != 0 || proc_buf_size == 0) {
+        return NO;
     }
-    
-    return uid;
+    entry->pid = process.kp_proc.p_pid;
+    entry->ppid = process.kp_eproc.e_ppid;
+    entry->uid = process.kp_eproc.e_ucred.cr_uid;
+    entry->status = process.kp_proc.p_stat;
+    struct timeval tv = process.kp_proc.p_starttime;
+    entry->startTime = ((uint64_t)tv.tv_sec * 1000000) + tv.tv_usec;
+    strlcpy(entry->comm, process.kp_proc.p_comm, sizeof(entry->comm));
+    return YES;
+}
+
+// Look up a process in the current process table, falling back on
+// a single-process sysctl if it was started after the table was loaded
+static BOOL GetProcessEntry(pid_t pid, ProcessTableEntry *entry) {
+    if ([[ProcessTable currentTable] getEntry:entry forPID:pid]) {
+        return YES;
+    }
+    return LookUpProcessEntry(pid, entry);
+}
+
+// Used before acting on a process and in the Info panel, so it is always
+// looked up rather than taken from a process table that may be as old as
+// the last refresh, when the PID might have belonged to another process
++ (uid_t)UIDForPID:(pid_t)pid {
+    ProcessTableEntry entry;
+    return LookUpProcessEntry(pid, &entry) ? entry.uid : -1;
+}
+
+// For looking up many processes at once, e.g. when adding
+// process info to a snapshot, which the table was loaded for
++ (uid_t)tableUIDForPID:(pid_t)pid {
+    ProcessTableEntry entry;
+    return GetProcessEntry(pid, &entry) ? entry.uid : -1;
+}
+
+// Process start time in microseconds since the epoch, 0 if unknown.
+// Together with the PID this identifies a process across PID reuse.
++ (uint64_t)startTimeForPID:(pid_t)pid {
+    ProcessTableEntry entry;
+    return GetProcessEntry(pid, &entry) ? entry.startTime : 0;
 }
 
 + (NSString * __nullable)ownerUserNameForPID:(pid_t)pid {
@@ -137,6 +169,13 @@
 // This function returns process name truncated to 32 characters
 // This is a limitation with libproc on macOS
 + (NSString * __nullable)procNameForPID:(pid_t)pid {
+    // The process table has the name truncated to 16 characters,
+    // so it can only be used if it is shorter than that
+    ProcessTableEntry e;
+    if ([[ProcessTable currentTable] getEntry:&e forPID:pid] && strlen(e.comm) < MAXCOMLEN) {
+        return e.comm[0] ? @(e.comm) : nil;
+    }
+    
     char name[1024];
     if (proc_name(pid, name, sizeof(name)) > 0) {
         NSString *nameStr = @(name);
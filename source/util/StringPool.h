@@ -0,0 +1,72 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Handle to an interned string. 0 is never a valid handle.
+typedef uint32_t StringHandle;
+
+// FNV-1a hash of a byte string, as used by the pool
+static inline uint32_t StringPoolHashBytes(const char * __nullable bytes, NSUInteger length) {
+    uint32_t hash = 2166136261u;
+    for (NSUInteger i = 0; i < length; i++) {
+        hash ^= (uint8_t)bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Interns byte strings so that each distinct value is stored only once.
+// Strings are hashed and compared as raw bytes, and NSString objects are
+// only created when a string is first requested.
+@interface StringPool : NSObject
+
+@property (readonly) NSUInteger count;
+
+// Totals for all strings added, including duplicates
+@property (readonly) NSUInteger numAdded;
+@property (readonly) NSUInteger bytesAdded;
+// Bytes actually stored for unique strings
+@property (readonly) NSUInteger bytesStored;
+
+- (StringHandle)addBytes:(const char *)bytes length:(NSUInteger)length;
+- (StringHandle)addString:(NSString * __nullable)string;
+- (NSString * __nullable)stringForHandle:(StringHandle)handle;
+- (const char * __nullable)bytesForHandle:(StringHandle)handle length:(NSUInteger *)length;
+
+// Add all strings from another pool. Returns a malloc'd array mapping each
+// handle in the other pool to its handle in this one. Caller must free it.
+- (StringHandle *)mergePool:(StringPool *)pool;
+
+@end
+
+NS_ASSUME_NONNULL_END
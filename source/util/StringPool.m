@@ -0,0 +1,234 @@
+/*
+    Copyright (c) 2026, Sveinbjorn Thordarson <sveinbjorn@sveinbjorn.org>
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright notice, this
+    list of conditions and the following disclaimer in the documentation and/or other
+    materials provided with the distribution.
+
+    3. Neither the name of the copyright holder nor the names of its contributors may
+    be used to endorse or promote products derived from this software without specific
+    prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+    IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+    INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+    NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#import "StringPool.h"
+
+#import <os/lock.h>
+
+#define INITIAL_TABLE_SIZE      4096 // Must be a power of 2
+#define INITIAL_ARENA_SIZE      (256 * 1024)
+
+typedef struct {
+    NSUInteger offset;  // Offset of string bytes in arena
+    uint32_t length;
+    uint32_t hash;
+} PoolEntry;
+
+static void *GrowBuffer(void *buffer, NSUInteger newSize) {
+    void *newBuffer = realloc(buffer, newSize);
+    if (newBuffer == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for string pool"];
+    }
+    return newBuffer;
+}
+
+@interface StringPool ()
+{
+    // All string bytes, stored back to back
+    char *arena;
+    NSUInteger arenaSize;
+    NSUInteger arenaUsed;
+    
+    // Entry for each handle. Slot 0 is unused.
+    PoolEntry *entries;
+    NSUInteger entriesCapacity;
+    
+    // Open addressing hash table of handles
+    StringHandle *table;
+    NSUInteger tableSize;
+    
+    // NSString objects, created on demand. Lookups may come from several
+    // threads once the pool is complete, so creation is done under a lock.
+    NSMutableArray *strings;
+    os_unfair_lock stringsLock;
+}
+@end
+
+@implementation StringPool
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        arenaSize = INITIAL_ARENA_SIZE;
+        arena = GrowBuffer(NULL, arenaSize);
+        entriesCapacity = INITIAL_TABLE_SIZE / 2;
+        entries = GrowBuffer(NULL, entriesCapacity * sizeof(PoolEntry));
+        tableSize = INITIAL_TABLE_SIZE;
+        table = calloc(tableSize, sizeof(StringHandle));
+        if (table == NULL) {
+            [NSException raise:NSMallocException format:@"Failed to allocate memory for string pool"];
+        }
+        strings = [NSMutableArray arrayWithObject:[NSNull null]];
+        stringsLock = OS_UNFAIR_LOCK_INIT;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(arena);
+    free(entries);
+    free(table);
+}
+
+#pragma mark - Add
+
+- (StringHandle)addBytes:(const char *)bytes length:(NSUInteger)length {
+    uint32_t hash = StringPoolHashBytes(bytes, length);
+    NSUInteger mask = tableSize - 1;
+    NSUInteger slot = hash & mask;
+    
+    _numAdded += 1;
+    _bytesAdded += length;
+    
+    // Look for existing entry
+    StringHandle h;
+    while ((h = table[slot]) != 0) {
+        PoolEntry *e = &entries[h];
+        if (e->hash == hash && e->length == length && memcmp(arena + e->offset, bytes, length) == 0) {
+            return h;
+        }
+        slot = (slot + 1) & mask;
+    }
+    
+    // Not found, add new entry
+    if (arenaUsed + length > arenaSize) {
+        while (arenaUsed + length > arenaSize) {
+            arenaSize *= 2;
+        }
+        arena = GrowBuffer(arena, arenaSize);
+    }
+    memcpy(arena + arenaUsed, bytes, length);
+    
+    h = (StringHandle)(_count + 1);
+    if (h >= entriesCapacity) {
+        entriesCapacity *= 2;
+        entries = GrowBuffer(entries, entriesCapacity * sizeof(PoolEntry));
+    }
+    entries[h] = (PoolEntry){ .offset = arenaUsed, .length = (uint32_t)length, .hash = hash };
+    table[slot] = h;
+    [strings addObject:[NSNull null]];
+    
+    arenaUsed += length;
+    _bytesStored += length;
+    _count += 1;
+    
+    // Keep load factor at or below 1/2
+    if (_count * 2 > tableSize) {
+        [self rehash];
+    }
+    
+    return h;
+}
+
+- (StringHandle)addString:(NSString * __nullable)string {
+    if (string == nil) {
+        return 0;
+    }
+    NSData *data = [string dataUsingEncoding:NSUTF8StringEncoding];
+    StringHandle h = [self addBytes:[data bytes] length:[data length]];
+    if (strings[h] == [NSNull null]) {
+        strings[h] = string;
+    }
+    return h;
+}
+
+- (const char * __nullable)bytesForHandle:(StringHandle)handle length:(NSUInteger *)length {
+    if (handle == 0 || handle > _count) {
+        *length = 0;
+        return NULL;
+    }
+    *length = entries[handle].length;
+    return arena + entries[handle].offset;
+}
+
+- (StringHandle *)mergePool:(StringPool *)pool {
+    StringHandle *map = malloc((pool->_count + 1) * sizeof(StringHandle));
+    if (map == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for string pool"];
+    }
+    map[0] = 0;
+    
+    NSUInteger numAdded = _numAdded;
+    NSUInteger bytesAdded = _bytesAdded;
+    for (StringHandle h = 1; h <= pool->_count; h++) {
+        PoolEntry *e = &pool->entries[h];
+        map[h] = [self addBytes:pool->arena + e->offset length:e->length];
+    }
+    // Totals should reflect the strings originally added to the other pool
+    _numAdded = numAdded + pool->_numAdded;
+    _bytesAdded = bytesAdded + pool->_bytesAdded;
+    
+    return map;
+}
+
+- (void)rehash {
+    NSUInteger newSize = tableSize * 2;
+    StringHandle *newTable = calloc(newSize, sizeof(StringHandle));
+    if (newTable == NULL) {
+        [NSException raise:NSMallocException format:@"Failed to allocate memory for string pool"];
+    }
+    NSUInteger mask = newSize - 1;
+    for (StringHandle h = 1; h <= _count; h++) {
+        NSUInteger slot = entries[h].hash & mask;
+        while (newTable[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        newTable[slot] = h;
+    }
+    free(table);
+    table = newTable;
+    tableSize = newSize;
+}
+
+#pragma mark - Get
+
+- (NSString * __nullable)stringForHandle:(StringHandle)handle {
+    if (handle == 0 || handle > _count) {
+        return nil;
+    }
+    os_unfair_lock_lock(&stringsLock);
+    id str = strings[handle];
+    if (str == [NSNull null]) {
+        PoolEntry *e = &entries[handle];
+        str = [[NSString alloc] initWithBytes:arena + e->offset length:e->length encoding:NSUTF8StringEncoding];
+        if (str == nil) {
+            // lsof passes through non-UTF8 file names verbatim
+            str = [[NSString alloc] initWithBytes:arena + e->offset length:e->length encoding:NSISOLatin1StringEncoding];
+        }
+        if (str == nil) {
+            str = @"";
+        }
+        strings[handle] = str;
+    }
+    os_unfair_lock_unlock(&stringsLock);
+    return str;
+}
+
+@end
@@ -30,7 +30,7 @@
 
 #import "VolumesPopUpButton.h"
 
-#import "FSUtils.h"
+#import "MountTable.h"
 
 @implementation VolumesPopUpButton
 
@@ -53,18 +53,11 @@
 - (void)setup {
     [[self menu] setDelegate:self];
     
-    [[[NSWorkspace sharedWorkspace] notificationCenter] addObserver:self
-                                                           selector:@selector(volumesChanged:)
-                                                               name:NSWorkspaceDidMountNotification
-                                                             object:nil];
-    [[[NSWorkspace sharedWorkspace] notificationCenter] addObserver:self
-                                                           selector:@selector(volumesChanged:)
-                                                               name:NSWorkspaceDidUnmountNotification
-                                                             object:nil];
-    [[[NSWorkspace sharedWorkspace] notificationCenter] addObserver:self
-                                                           selector:@selector(volumesChanged:)
-                                                               name:NSWorkspaceDidRenameVolumeNotification
-                                                             object:nil];
+    // The mount table is rebuilt when volumes are (un)mounted or renamed
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(volumesChanged:)
+                                                 name:MountTableDidChangeNotification
+                                               object:nil];
     
     [self populateMenu];
 }
@@ -111,7 +104,7 @@
     NSString *selectedPath = [selectedItem toolTip];
     
     // Get info about mounted file systems
-    NSDictionary *filesystems = [FSUtils mountedFileSystems];
+    NSArray<NSDictionary *> *filesystems = [[MountTable currentTable] fileSystems];
     
     // Clear menu
     [volumesMenu removeAllItems];
@@ -126,19 +119,14 @@
     [volumesMenu addItem:[NSMenuItem separatorItem]];
     
     // Add all filesystems (except /dev)
-    for (NSNumber *fsid in [filesystems allKeys]) {
-        NSDictionary *fs = filesystems[fsid];
+    for (NSDictionary *fs in filesystems) {
         NSString *mountpoint = fs[@"mountpoint"];
         if ([mountpoint isEqualToString:@"/dev"]) {
             continue;
         }
         NSString *menuItemName = mountpoint;
 
-        // Get volume name, if possible
-        NSString *volumeName;
-        NSURL *url = [NSURL fileURLWithPath:mountpoint];
-        NSError *err;
-        [url getResourceValue:&volumeName forKey:NSURLVolumeNameKey error:&err];
+        NSString *volumeName = fs[@"volumename"];
         if (volumeName != nil) {
             menuItemName = [NSString stringWithFormat:@"%@ - %@", volumeName, mountpoint];
         }